@@ -0,0 +1,250 @@
+// NUMA-aware, huge-page grid allocator
+//
+// Talks to the kernel directly (mmap, madvise, mbind, move_pages) so the
+// drivers do not need libnuma.
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <omp.h>
+
+#include "grid_alloc.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+// Memory policies from <linux/mempolicy.h>
+#define GA_MPOL_BIND       2
+#define GA_MPOL_INTERLEAVE 3
+
+#define GA_MAX_NODES  64
+#define GA_MAX_ALLOCS 64
+#define GA_THP_ALIGN  (2UL << 20)
+#define GA_SAMPLES    4096
+
+typedef enum { PAGES_4K, PAGES_THP, PAGES_2M, PAGES_1G } pages_t;
+typedef enum { NUMA_FIRST_TOUCH, NUMA_INTERLEAVE, NUMA_BIND } numa_t;
+
+static const char *page_names[] = { "4k", "thp", "2m", "1g" };
+static const char *numa_names[] = { "first-touch", "interleave", "bind" };
+
+// Live allocations; munmap needs the mapping, not just the pointer
+typedef struct {
+    void *ptr;
+    void *map;
+    size_t map_bytes;
+    size_t bytes;
+    pages_t pages;
+    numa_t numa;
+} ga_entry_t;
+
+static ga_entry_t entries[GA_MAX_ALLOCS];
+
+static pages_t env_pages(void) {
+    const char *s = getenv("GRID_PAGES");
+    for (int k = 0; s != NULL && k < 4; k++) {
+        if (strcmp(s, page_names[k]) == 0) {
+            return (pages_t) k;
+        }
+    }
+    return PAGES_THP;
+}
+
+static numa_t env_numa(void) {
+    const char *s = getenv("GRID_NUMA");
+    for (int k = 0; s != NULL && k < 3; k++) {
+        if (strcmp(s, numa_names[k]) == 0) {
+            return (numa_t) k;
+        }
+    }
+    return NUMA_FIRST_TOUCH;
+}
+
+static int num_nodes(void) {
+    DIR *dir = opendir("/sys/devices/system/node");
+    struct dirent *de;
+    int n = 0;
+
+    if (dir == NULL) {
+        return 1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "node", 4) == 0 && de->d_name[4] >= '0' && de->d_name[4] <= '9') {
+            n++;
+        }
+    }
+    closedir(dir);
+    return n > 0 ? n : 1;
+}
+
+static long mbind_range(void *addr, size_t len, int mode, unsigned long mask) {
+    return syscall(SYS_mbind, addr, len, mode, &mask, GA_MAX_NODES, 0);
+}
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+// Try hugetlbfs first when asked, then anonymous memory aligned for THP
+static void *map_pages(ga_entry_t *e, size_t bytes, pages_t want) {
+    void *p;
+
+    if (want == PAGES_1G || want == PAGES_2M) {
+        size_t page = want == PAGES_1G ? 1UL << 30 : 2UL << 20;
+        int flag = want == PAGES_1G ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+        size_t len = round_up(bytes, page);
+
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | flag, -1, 0);
+        if (p != MAP_FAILED) {
+            e->map = e->ptr = p;
+            e->map_bytes = len;
+            e->pages = want;
+            return p;
+        }
+        if (want == PAGES_1G) {
+            return map_pages(e, bytes, PAGES_2M);
+        }
+        want = PAGES_THP;
+    }
+
+    size_t len = round_up(bytes, GA_THP_ALIGN) + GA_THP_ALIGN;
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    e->map = p;
+    e->map_bytes = len;
+    e->ptr = (void *) round_up((size_t) p, GA_THP_ALIGN);
+    e->pages = want;
+    if (want == PAGES_THP) {
+        madvise(e->ptr, round_up(bytes, GA_THP_ALIGN), MADV_HUGEPAGE);
+    } else {
+        madvise(e->ptr, round_up(bytes, GA_THP_ALIGN), MADV_NOHUGEPAGE);
+    }
+    return e->ptr;
+}
+
+void *grid_alloc(size_t nunits, size_t unit_bytes) {
+    size_t bytes = nunits * unit_bytes;
+    ga_entry_t *e = NULL;
+
+    for (int k = 0; k < GA_MAX_ALLOCS; k++) {
+        if (entries[k].ptr == NULL) {
+            e = &entries[k];
+            break;
+        }
+    }
+    if (e == NULL || bytes == 0) {
+        return NULL;
+    }
+
+    char *p = (char *) map_pages(e, bytes, env_pages());
+    if (p == NULL) {
+        return NULL;
+    }
+    e->bytes = bytes;
+    e->numa = env_numa();
+
+    int nodes = num_nodes();
+    if (e->numa == NUMA_INTERLEAVE && nodes > 1) {
+        unsigned long mask = nodes >= 64 ? ~0UL : (1UL << nodes) - 1;
+        mbind_range(p, round_up(bytes, getpagesize()), GA_MPOL_INTERLEAVE, mask);
+    }
+
+    // Touch with the same static partition the compute loops use
+    #pragma omp parallel
+    {
+        int nt = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        size_t lo = nunits * tid / nt * unit_bytes;
+        size_t hi = nunits * (tid + 1) / nt * unit_bytes;
+
+        if (e->numa == NUMA_BIND && nodes > 1 && hi > lo) {
+            unsigned cpu, node;
+            size_t page = getpagesize();
+            size_t blo = round_up(lo, page), bhi = hi / page * page;
+            if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && bhi > blo) {
+                mbind_range(p + blo, bhi - blo, GA_MPOL_BIND, 1UL << node);
+            }
+        }
+        if (hi > lo) {
+            memset(p + lo, 0, hi - lo);
+        }
+    }
+
+    return p;
+}
+
+void grid_free(void *ptr) {
+    for (int k = 0; k < GA_MAX_ALLOCS; k++) {
+        if (ptr != NULL && entries[k].ptr == ptr) {
+            munmap(entries[k].map, entries[k].map_bytes);
+            memset(&entries[k], 0, sizeof(entries[k]));
+            return;
+        }
+    }
+}
+
+void grid_report(const char *label, void *ptr) {
+    ga_entry_t *e = NULL;
+    for (int k = 0; k < GA_MAX_ALLOCS; k++) {
+        if (ptr != NULL && entries[k].ptr == ptr) {
+            e = &entries[k];
+        }
+    }
+    if (e == NULL) {
+        return;
+    }
+
+    // Ask the kernel where a sample of pages lives (nodes == NULL queries)
+    size_t page = getpagesize();
+    size_t npages = (e->bytes + page - 1) / page;
+    size_t nsamples = npages < GA_SAMPLES ? npages : GA_SAMPLES;
+    void **pages = (void **) malloc(nsamples * sizeof(void *));
+    int *status = (int *) malloc(nsamples * sizeof(int));
+    long per_node[GA_MAX_NODES] = { 0 };
+    long unknown = 0;
+
+    for (size_t s = 0; s < nsamples; s++) {
+        pages[s] = (char *) ptr + (npages * s / nsamples) * page;
+    }
+    if (syscall(SYS_move_pages, 0, nsamples, pages, NULL, status, 0) != 0) {
+        for (size_t s = 0; s < nsamples; s++) {
+            status[s] = -1;
+        }
+    }
+    for (size_t s = 0; s < nsamples; s++) {
+        if (status[s] >= 0 && status[s] < GA_MAX_NODES) {
+            per_node[status[s]]++;
+        } else {
+            unknown++;
+        }
+    }
+
+    char line[512];
+    int len = snprintf(line, sizeof(line), "%s/%s", page_names[e->pages], numa_names[e->numa]);
+    for (int n = 0; n < GA_MAX_NODES && len < (int) sizeof(line); n++) {
+        if (per_node[n] > 0) {
+            len += snprintf(line + len, sizeof(line) - len, "  node%d %.1f%%", n, 100.0 * per_node[n] / nsamples);
+        }
+    }
+    if (unknown > 0 && len < (int) sizeof(line)) {
+        snprintf(line + len, sizeof(line) - len, "  unmapped %.1f%%", 100.0 * unknown / nsamples);
+    }
+    printf("%-25s: %s\n", label, line);
+
+    free(pages);
+    free(status);
+}
@@ -0,0 +1,31 @@
+// Header File for the NUMA-aware, huge-page grid allocator
+//
+// All drivers allocate their large arrays through grid_alloc().  Behaviour
+// is picked at run time from the environment:
+//
+//   GRID_PAGES = 4k | thp | 2m | 1g     (default thp)
+//       2m/1g ask for hugetlbfs pages with mmap(MAP_HUGETLB) and fall back
+//       to transparent huge pages (madvise) when none are reserved.
+//   GRID_NUMA  = first-touch | interleave | bind   (default first-touch)
+//       first-touch: each OpenMP thread touches the units a schedule(static)
+//                    loop over the same units would give it
+//       interleave:  pages are spread round-robin over all nodes
+//       bind:        like first-touch, but each thread's range is also
+//                    mbind()-ed to the node the thread is running on
+#ifndef GRID_ALLOC_H
+#define GRID_ALLOC_H
+
+#include <stddef.h>
+
+// Allocate nunits * unit_bytes and place the pages as if a
+// `#pragma omp parallel for schedule(static)` loop over the nunits units
+// (rows of a grid, elements of a vector) had touched them.  Returns NULL
+// on failure.
+void *grid_alloc(size_t nunits, size_t unit_bytes);
+
+void grid_free(void *);
+
+// Print the page kind and how the pages of p are spread over NUMA nodes
+void grid_report(const char *label, void *p);
+
+#endif
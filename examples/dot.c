@@ -1,7 +1,10 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <omp.h>
 
+#include "grid_alloc.h"
+
 // dot product of 2 1d arrays
 
 int main() {
@@ -13,8 +16,9 @@ int main() {
         (float) sizeof(float) * (float) SIZE / (1024.0 * 1024.0));
 
     // allocate memory
-    float *x = malloc(SIZE * sizeof(float));
-    float *y = malloc(SIZE * sizeof(float));
+    // pages are placed for the static schedule of the dot product loop
+    float *x = grid_alloc(SIZE, sizeof(float));
+    float *y = grid_alloc(SIZE, sizeof(float));
 
     if (x == NULL || y == NULL) // ensures mallocs were allocated correctly
         exit(-1);
@@ -83,12 +87,12 @@ int main() {
     float per_of_peak_ops_skt = 100 * ops_per_clock / peak_ops_per_clock_per_skt;
 
     printf("---------------------Results--------------------\n");
-    pritnf("%-31s: %10ld\n", "Number of elements per array", 2 * SIZE);
-    printf("%-31s: %10.2f MB\n\n", "Size of each array", (float) sizeof(float) * (float) N / mb);
+    printf("%-31s: %10ld\n", "Number of elements per array", 2L * SIZE);
+    printf("%-31s: %10.2f MB\n\n", "Size of each array", (float) sizeof(float) * (float) SIZE / (1024.0 * 1024.0));
 
     printf("%31s: %10.4e\n", "Calculated dot product", sum);
     // Theoretical dot product result
-    pritnf("%31s: %10.4e\n\n", "Correct dot product", -1);
+    printf("%31s: %10.4e\n\n", "Correct dot product", -1.0);
     
     printf("%31s: %10d\n", "Times dot product calculated", dot_times);
     
@@ -101,4 +105,9 @@ int main() {
     printf("%31s: %10.4f\n", "FLOPs per clock per thread", ops_per_clk_per_thread);
     printf("%31s: %10.3f %%\n", "Percentage of peak thread FLOPs", per_of_peak_ops_per_thd);
     printf("%31s: %10.3f %%\n", "Percentage of peak socket FLOPs", per_of_peak_ops_skt);
+    grid_report("Pages of x", x);
+    grid_report("Pages of y", y);
+
+    grid_free(x);
+    grid_free(y);
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <omp.h>
+
+#include "grid_alloc.h"
+#include "team.h"
+
+int place_omp(void);    // placement prototype (hw1/part2/rb/affinity.c)
+
+// dot product of 2 1d arrays: OpenMP parallel for + reduction against the
+// persistent team of hw1/part2/rb/team.c (team_run + team_sum)
+
+typedef struct {
+    const float *x, *y;
+    long n;
+    int times;
+    float sum;
+} dot_t;
+
+static float *fill_x, *fill_y;
+
+static void fill(long lo, long hi, void *arg) {
+    (void) arg;
+    for (long i = lo; i < hi; i++) {
+        fill_x[i] = 3;
+        fill_y[i] = 3.3333;
+    }
+}
+
+static void dot_member(team_t *team, int id, void *arg) {
+    dot_t *d = (dot_t *) arg;
+    long lo, hi;
+    float sum = 0;
+
+    team_range(team, id, d->n, &lo, &hi);
+    for (int t = 0; t < d->times; t++) {
+        float part = 0;
+        for (long i = lo; i < hi; i++) {
+            part = part + d->x[i] * d->y[i];
+        }
+        sum = team_sum(team, id, part);
+    }
+    if (id == 0) {
+        d->sum = sum;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // set the size n
+    const uint32_t SIZE = argc > 1 ? atol(argv[1]) : 50000000;
+    int dot_times = argc > 2 ? atoi(argv[2]) : 200;
+    int num_threads = omp_get_max_threads();
+
+    float *x = grid_alloc(SIZE, sizeof(float));
+    float *y = grid_alloc(SIZE, sizeof(float));
+
+    if (x == NULL || y == NULL) // ensures mallocs were allocated correctly
+        exit(-1);
+
+    // Both teams are pinned the same way (RB_PLACE)
+    place_omp();
+    team_t *team = team_create(num_threads, 1);
+    if (team == NULL) // ensures the team's memory and threads were created
+        exit(-1);
+    fill_x = x;
+    fill_y = y;
+    team_parallel_for(team, SIZE, fill, NULL);
+
+    // OpenMP: one parallel for + reduction per dot product, as in dot.c
+    float sum = 0;
+    double start = omp_get_wtime();
+    for (int i = 0; i < dot_times; i++) {
+        sum = 0;
+        #pragma omp parallel for schedule(static) reduction(+:sum)
+        for(uint32_t i = 0; i < SIZE; i++) {
+            sum = sum + x[i] * y[i];
+        }
+    }
+    double omp_time = omp_get_wtime() - start;
+
+    // Team: one team_run, a fused barrier + sum per dot product
+    dot_t d = { x, y, SIZE, dot_times, 0 };
+    start = omp_get_wtime();
+    team_run(team, dot_member, &d);
+    double team_time = omp_get_wtime() - start;
+
+    float gb = dot_times * (float) SIZE * sizeof(float) * 2.0 / (1024.0 * 1024.0 * 1024.0);
+
+    printf("---------------------Results--------------------\n");
+    printf("%-31s: %10ld\n", "Number of elements per array", (long) SIZE);
+    printf("%-31s: %10d\n", "Times dot product calculated", dot_times);
+    printf("%-31s: %10d\n\n", "Number of threads", num_threads);
+
+    printf("%31s  %12s %12s\n", "", "OpenMP", "team");
+    printf("%31s: %12.4e %12.4e\n", "Calculated dot product", sum, d.sum);
+    printf("%31s: %12.3f %12.3f\n", "Time taken (s)", omp_time, team_time);
+    printf("%31s: %12.3f %12.3f\n", "Per dot product (us)", 1e6 * omp_time / dot_times, 1e6 * team_time / dot_times);
+    printf("%31s: %12.2f %12.2f\n", "GB/s", gb / omp_time, gb / team_time);
+
+    team_destroy(team);
+    grid_free(x);
+    grid_free(y);
+}
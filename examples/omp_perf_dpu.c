@@ -4,15 +4,18 @@
 #include <omp.h>
 #include <stdint.h> // For specific-width integers
 #include <stdio.h>
+#include <stdlib.h>
+
+#include "grid_alloc.h"
 
 int main() {
 
     const uint32_t N = 50000000;
     const float mb = 1024.0 * 1024.0;
 
-    // Allocate arrays
-    float * x = malloc(N * sizeof(float));
-    float * y = malloc(N * sizeof(float));
+    // Allocate arrays, placed for the static schedule of the kernel
+    float * x = grid_alloc(N, sizeof(float));
+    float * y = grid_alloc(N, sizeof(float));
 
     if(x == NULL) {
         printf("Allocation of array X failed!\n");
@@ -115,5 +118,9 @@ int main() {
     printf("%-31s: %10.3f %%\n", "Percentage of peak thread FLOPs", per_of_peak_ops_per_thd);
     printf("%-31s: %10.3f %%\n", "Percentage of peak socket FLOPs" ,per_of_peak_ops_skt);
     printf("%-31s: %10.3f %%\n", "Percentage of peak memory", per_of_mem_peak);
+    grid_report("Pages of x", x);
+    grid_report("Pages of y", y);
 
+    grid_free(x);
+    grid_free(y);
 }
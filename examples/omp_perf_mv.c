@@ -4,15 +4,19 @@
 #include <omp.h>
 #include <stdint.h> // For specific-width integers
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
+#include "grid_alloc.h"
+
 int main() {
     const uint32_t M = 200;
     const uint32_t N = 2*2*2*3*3*5 * pow(2,17);
     const float mb = 1024.0 * 1024.0;
 
     // Allocate arrays
-    float * mat = malloc( (long) M*N * sizeof(float));
+    // One unit per matrix row, matching the parallel loop over m
+    float * mat = grid_alloc(M, (size_t) N * sizeof(float));
     float * vec = malloc(N * sizeof(float));
     float * res = malloc(M * sizeof(float));
 
@@ -162,5 +166,9 @@ int main() {
     printf("%-31s: %10.3f %%\n", "Percentage of peak thread FLOPs", per_of_peak_ops_per_thd);
     printf("%-31s: %10.3f %%\n", "Percentage of peak socket FLOPs" ,per_of_peak_ops_skt);
     printf("%-31s: %10.3f %%\n", "Percentage of peak memory", per_of_mem_peak);
+    grid_report("Pages of mat", mat);
 
+    grid_free(mat);
+    free(vec);
+    free(res);
 }
@@ -109,16 +109,16 @@ void main() {
 }
 
 void initialize(float *array, size_t array_size) {
-    for (size_t i = 0; i < array_size; i++) {
-        for (size_t j = 0; j < array_size; j++) {
+    for (size_t j = 0; j < array_size; j++) {
+        for (size_t i = 0; i < array_size; i++) {
             array[i + j * array_size] = (float)abs(i % 11 - j % 5) / (i % 7 + j % 3 + 1);
         }
     }
 }
 
 void smooth(float *array, float *out_array, size_t array_size, float a, float b, float c) {
-    for (size_t i = 1; i < array_size - 1; i++) {
-        for (size_t j = 1; j < array_size - 1; j++) {
+    for (size_t j = 1; j < array_size - 1; j++) {
+        for (size_t i = 1; i < array_size - 1; i++) {
             out_array[i + j * array_size] = 
                 a * (array[(i - 1) + (j - 1) * array_size] +
                     array[(i - 1) + (j + 1) * array_size] +
@@ -135,8 +135,8 @@ void smooth(float *array, float *out_array, size_t array_size, float a, float b,
 
 
 void count(float *array, size_t array_size, float threshold, float *below_threshold) {
-    for (size_t i = 1; i < array_size - 1; i++) {
-        for (size_t j = 1; j < array_size - 1; j++) {
+    for (size_t j = 1; j < array_size - 1; j++) {
+        for (size_t i = 1; i < array_size - 1; i++) {
             if (array[i + j * array_size] < threshold) {
                 *below_threshold = *below_threshold + 1;
             }
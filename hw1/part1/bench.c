@@ -0,0 +1,338 @@
+// Benchmark harness for the part1 smoothing workload
+//
+// usage: a.out_bench [--size=N] [--threads=T1,T2,...] [--kernel=K1,K2,...|all]
+//                    [--reps=R] [--warmup=W] [--format=text|csv|json]
+//                    [--coeffs=a,b,c] [--threshold=t]
+//
+// Every option can also come from the environment (BENCH_SIZE, BENCH_THREADS,
+// BENCH_KERNEL, BENCH_REPS, BENCH_WARMUP, BENCH_FORMAT, BENCH_COEFFS,
+// BENCH_THRESHOLD); the command line wins.  For each thread count the phases
+// init, count and fused smooth+count run once, smooth once per kernel.  Each
+// phase gets W untimed warm-up runs and R timed ones, and is reported as
+// min / median / p95 time plus GB/s and cell updates/s at the median.
+//
+// The arrays are allocated (and first-touched) once with the largest thread
+// count, so smaller counts in a sweep see the same page placement.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+#define MAX_LIST 64
+
+typedef enum { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON } format_t;
+
+typedef struct {
+    long array_size;
+    int threads[MAX_LIST], nthreads;
+    const smooth_kernel_t *kernels[MAX_LIST];
+    int nkernels;
+    int reps, warmup;
+    format_t format;
+    float a, b, c, threshold;
+} bench_config_t;
+
+typedef struct {
+    const char *phase;
+    const char *kernel;
+    int threads;
+    double min, median, p95;
+    double bytes;           // memory traffic of one run
+    double cells;           // cells updated (or visited) by one run
+} bench_result_t;
+
+// Option value from "--name=value" on the command line, else from the
+// environment variable, else NULL
+static const char *option(int argc, char *argv[], const char *name, const char *env) {
+    size_t len = strlen(name);
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], name, len) == 0 && argv[k][len] == '=') {
+            return argv[k] + len + 1;
+        }
+    }
+    return getenv(env);
+}
+
+static int parse_ints(const char *s, int *out, int max) {
+    int n = 0;
+    char *copy = strdup(s);
+    for (char *tok = strtok(copy, ","); tok != NULL && n < max; tok = strtok(NULL, ",")) {
+        out[n++] = atoi(tok);
+    }
+    free(copy);
+    return n;
+}
+
+static int parse_kernels(const char *s, const smooth_kernel_t **out, int max) {
+    int n = 0;
+
+    if (strcmp(s, "all") == 0) {
+        const smooth_kernel_t *k;
+        for (int i = 0; (k = smooth_kernel_get(i)) != NULL && n < max; i++) {
+            if (k->supported()) {
+                out[n++] = k;
+            }
+        }
+        return n;
+    }
+
+    char *copy = strdup(s);
+    for (char *tok = strtok(copy, ","); tok != NULL && n < max; tok = strtok(NULL, ",")) {
+        const smooth_kernel_t *k = smooth_kernel_select(tok);
+        if (k == NULL) {
+            fprintf(stderr, "Kernel %s is unknown or not supported on this CPU\n", tok);
+            exit(1);
+        }
+        out[n++] = k;
+    }
+    free(copy);
+    return n;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--size=N] [--threads=T1,T2,...] [--kernel=K1,K2,...|all]\n"
+                    "       [--reps=R] [--warmup=W] [--format=text|csv|json]\n"
+                    "       [--coeffs=a,b,c] [--threshold=t]\n", prog);
+    exit(1);
+}
+
+static void configure(int argc, char *argv[], bench_config_t *cfg) {
+    static const char *known[] = { "--size", "--threads", "--kernel", "--reps", "--warmup",
+                                   "--format", "--coeffs", "--threshold" };
+    const char *s;
+
+    for (int k = 1; k < argc; k++) {
+        int ok = 0;
+        for (int i = 0; i < (int) (sizeof(known) / sizeof(known[0])); i++) {
+            size_t len = strlen(known[i]);
+            ok |= strncmp(argv[k], known[i], len) == 0 && argv[k][len] == '=';
+        }
+        if (!ok) {
+            usage(argv[0]);
+        }
+    }
+
+    cfg->array_size = (s = option(argc, argv, "--size", "BENCH_SIZE")) ? atol(s) : 8194;
+    cfg->reps = (s = option(argc, argv, "--reps", "BENCH_REPS")) ? atoi(s) : 10;
+    cfg->warmup = (s = option(argc, argv, "--warmup", "BENCH_WARMUP")) ? atoi(s) : 2;
+
+    cfg->nthreads = 0;
+    if ((s = option(argc, argv, "--threads", "BENCH_THREADS")) != NULL) {
+        cfg->nthreads = parse_ints(s, cfg->threads, MAX_LIST);
+    }
+    if (cfg->nthreads == 0) {
+        cfg->threads[0] = omp_get_max_threads();
+        cfg->nthreads = 1;
+    }
+
+    s = option(argc, argv, "--kernel", "BENCH_KERNEL");
+    cfg->nkernels = parse_kernels(s ? s : "auto", cfg->kernels, MAX_LIST);
+
+    s = option(argc, argv, "--format", "BENCH_FORMAT");
+    if (s == NULL || strcmp(s, "text") == 0) {
+        cfg->format = FORMAT_TEXT;
+    } else if (strcmp(s, "csv") == 0) {
+        cfg->format = FORMAT_CSV;
+    } else if (strcmp(s, "json") == 0) {
+        cfg->format = FORMAT_JSON;
+    } else {
+        usage(argv[0]);
+    }
+
+    cfg->a = 0.05;
+    cfg->b = 0.1;
+    cfg->c = 0.4;
+    if ((s = option(argc, argv, "--coeffs", "BENCH_COEFFS")) != NULL &&
+        sscanf(s, "%f,%f,%f", &cfg->a, &cfg->b, &cfg->c) != 3) {
+        usage(argv[0]);
+    }
+    cfg->threshold = (s = option(argc, argv, "--threshold", "BENCH_THRESHOLD")) ? atof(s) : 0.1;
+
+    if (cfg->array_size < 3 || cfg->reps < 1 || cfg->warmup < 0) {
+        usage(argv[0]);
+    }
+}
+
+static int cmp_double(const void *p, const void *q) {
+    double a = *(const double *) p, b = *(const double *) q;
+    return (a > b) - (a < b);
+}
+
+// Arguments of one benchmarked phase
+typedef struct {
+    const bench_config_t *cfg;
+    const smooth_kernel_t *kernel;
+    float *x, *y;
+    long x_below, y_below;
+} phase_args_t;
+
+static void run_init(phase_args_t *p) {
+    initialize(p->x, p->cfg->array_size);
+}
+
+static void run_smooth(phase_args_t *p) {
+    p->kernel->smooth(p->x, p->y, p->cfg->array_size, p->cfg->a, p->cfg->b, p->cfg->c);
+}
+
+static void run_count(phase_args_t *p) {
+    count(p->x, p->cfg->array_size, p->cfg->threshold, &p->x_below);
+    count(p->y, p->cfg->array_size, p->cfg->threshold, &p->y_below);
+}
+
+static void run_fused(phase_args_t *p) {
+    smooth_count(p->x, p->y, p->cfg->array_size, p->cfg->a, p->cfg->b, p->cfg->c,
+                 p->cfg->threshold, &p->x_below, &p->y_below);
+}
+
+// Warm up, time reps runs and summarise them
+static void measure(void (*run)(phase_args_t *), phase_args_t *p, bench_result_t *r) {
+    int reps = p->cfg->reps;
+    double *times = (double *) malloc(reps * sizeof(double));
+    struct timespec start, stop;
+
+    for (int k = 0; k < p->cfg->warmup; k++) {
+        run(p);
+    }
+    for (int k = 0; k < reps; k++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        run(p);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        times[k] = elapsed(start, stop);
+    }
+
+    qsort(times, reps, sizeof(double), cmp_double);
+    r->min = times[0];
+    r->median = reps % 2 ? times[reps / 2] : 0.5 * (times[reps / 2 - 1] + times[reps / 2]);
+    r->p95 = times[(95 * reps + 99) / 100 - 1];
+    free(times);
+}
+
+static void print_header(const bench_config_t *cfg) {
+    switch (cfg->format) {
+    case FORMAT_TEXT:
+        printf("%-45s: %ld\n", "Number of elements in a row/column", cfg->array_size);
+        printf("%-45s: %3f\n", "Memory (GB) used per array",
+               sizeof(float) * (double) cfg->array_size * cfg->array_size / 1073741824.0);
+        printf("%-45s: %d + %d warm-up\n", "Repetitions per phase", cfg->reps, cfg->warmup);
+        printf("%-45s: %.2f %.2f %.2f\n", "Smoothing constants (a, b, c)", cfg->a, cfg->b, cfg->c);
+        printf("%-45s: %.3f\n", "Threshold", cfg->threshold);
+        printf("\n%7s %-7s %-9s %10s %10s %10s %9s %10s\n", "threads", "phase", "kernel",
+               "min (s)", "median (s)", "p95 (s)", "GB/s", "GCells/s");
+        break;
+    case FORMAT_CSV:
+        printf("size,threads,phase,kernel,reps,warmup,min_s,median_s,p95_s,gb_per_s,cells_per_s\n");
+        break;
+    case FORMAT_JSON:
+        printf("{\n  \"size\": %ld,\n  \"reps\": %d,\n  \"warmup\": %d,\n", cfg->array_size, cfg->reps, cfg->warmup);
+        printf("  \"coeffs\": [%g, %g, %g],\n  \"threshold\": %g,\n", cfg->a, cfg->b, cfg->c, cfg->threshold);
+        printf("  \"results\": [");
+        break;
+    }
+}
+
+static void print_result(const bench_config_t *cfg, const bench_result_t *r, int first) {
+    double gbs = r->bytes / 1073741824.0 / r->median;
+    double cps = r->cells / r->median;
+
+    switch (cfg->format) {
+    case FORMAT_TEXT:
+        printf("%7d %-7s %-9s %10.4f %10.4f %10.4f %9.2f %10.3f\n", r->threads, r->phase, r->kernel,
+               r->min, r->median, r->p95, gbs, cps / 1.0e9);
+        break;
+    case FORMAT_CSV:
+        printf("%ld,%d,%s,%s,%d,%d,%.6f,%.6f,%.6f,%.3f,%.0f\n", cfg->array_size, r->threads, r->phase,
+               r->kernel, cfg->reps, cfg->warmup, r->min, r->median, r->p95, gbs, cps);
+        break;
+    case FORMAT_JSON:
+        printf("%s\n    {\"threads\": %d, \"phase\": \"%s\", \"kernel\": \"%s\", "
+               "\"min_s\": %.6f, \"median_s\": %.6f, \"p95_s\": %.6f, "
+               "\"gb_per_s\": %.3f, \"cells_per_s\": %.0f}",
+               first ? "" : ",", r->threads, r->phase, r->kernel, r->min, r->median, r->p95, gbs, cps);
+        break;
+    }
+    fflush(stdout);
+}
+
+static void print_footer(const bench_config_t *cfg) {
+    if (cfg->format == FORMAT_JSON) {
+        printf("\n  ]\n}\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    bench_config_t cfg;
+    configure(argc, argv, &cfg);
+
+    long n = cfg.array_size;
+    double cells = (double) n * n;
+    double in_cells = (double) (n - 2) * (n - 2);
+    int max_threads = 1;
+    for (int t = 0; t < cfg.nthreads; t++) {
+        max_threads = cfg.threads[t] > max_threads ? cfg.threads[t] : max_threads;
+    }
+
+    // Allocate with the widest team so every thread count sees the same pages
+    omp_set_num_threads(max_threads);
+    float *x = (float *) grid_alloc(n, n * sizeof(float));
+    float *y = (float *) grid_alloc(n, n * sizeof(float));
+    if (x == NULL || y == NULL) {
+        fprintf(stderr, "Allocation of arrays failed!\n");
+        exit(-1);
+    }
+    initialize(x, n);
+    copy_border(x, y, n);
+
+    phase_args_t args = { &cfg, NULL, x, y, 0, 0 };
+    bench_result_t r;
+    int first = 1;
+
+    print_header(&cfg);
+
+    for (int t = 0; t < cfg.nthreads; t++) {
+        omp_set_num_threads(cfg.threads[t]);
+        r.threads = cfg.threads[t];
+
+        // Init writes x; count reads x and y; smooth and fused read x and write y
+        r.phase = "init";
+        r.kernel = "-";
+        r.bytes = sizeof(float) * cells;
+        r.cells = cells;
+        measure(run_init, &args, &r);
+        print_result(&cfg, &r, first);
+        first = 0;
+
+        for (int k = 0; k < cfg.nkernels; k++) {
+            args.kernel = cfg.kernels[k];
+            r.phase = "smooth";
+            r.kernel = args.kernel->name;
+            r.bytes = 2.0 * sizeof(float) * cells;
+            r.cells = in_cells;
+            measure(run_smooth, &args, &r);
+            print_result(&cfg, &r, first);
+        }
+
+        r.phase = "count";
+        r.kernel = "-";
+        r.bytes = 2.0 * sizeof(float) * cells;
+        r.cells = 2.0 * in_cells;
+        measure(run_count, &args, &r);
+        print_result(&cfg, &r, first);
+
+        r.phase = "fused";
+        r.kernel = "-";
+        r.bytes = 2.0 * sizeof(float) * cells;
+        r.cells = in_cells;
+        measure(run_fused, &args, &r);
+        print_result(&cfg, &r, first);
+    }
+
+    print_footer(&cfg);
+
+    grid_free(x);
+    grid_free(y);
+}
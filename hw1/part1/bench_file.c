@@ -0,0 +1,108 @@
+// Benchmark: saving and loading grids in the chunked file format
+//
+// usage: a.out_bench_file [array_size] [tile] [dir]
+// For each codec: write x and y, read them back whole and as a sub-rectangle,
+// and compare the read time against regenerating x with initialize().
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const long array_size = argc > 1 ? atol(argv[1]) : 8194;
+    const int tile = argc > 2 ? atoi(argv[2]) : 256;
+    const char *dir = argc > 3 ? argv[3] : ".";
+
+    size_t bytes = array_size * array_size * sizeof(float);
+    long sub = array_size / 8;
+    char path[4096];
+    struct timespec start, stop;
+    struct stat st;
+    double init_time;
+
+    float *x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *back = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *part = (float *) malloc(sub * sub * sizeof(float));
+
+    if (x == NULL || y == NULL || back == NULL || part == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    initialize(x, array_size);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    init_time = elapsed(start, stop);
+    copy_border(x, y, array_size);
+    smooth(x, y, array_size, a, b, c);
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3f\n", "Memory (GB) used per array", bytes / 1073741824.0);
+    printf("%-45s: %d x %d\n", "Tile size", tile, tile);
+    printf("%-45s: %.3f\n", "CPU: initialize() x", init_time);
+    #ifdef _OPENMP
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    printf("\n%-5s %-10s %8s %10s %10s %10s %12s %9s\n", "array", "codec", "ratio",
+           "write (s)", "read (s)", "read GB/s", "1/64 rect (s)", "lossless");
+
+    for (int codec = GRID_CODEC_NONE; codec <= GRID_CODEC_XOR_LZ; codec++) {
+        for (int which = 0; which < 2; which++) {
+            const float *src = which == 0 ? x : y;
+            double write_time, read_time, rect_time;
+            int same = 1;
+
+            snprintf(path, sizeof(path), "%s/bench_%c_%s.grid", dir, which == 0 ? 'x' : 'y',
+                     grid_codec_name(codec));
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (grid_file_write(path, src, array_size, array_size, tile, tile, codec) != 0) {
+                printf("Could not write %s\n", path);
+                exit(1);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            write_time = elapsed(start, stop);
+            stat(path, &st);
+
+            memset(back, 0, bytes);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            same &= grid_file_read(path, back, 0, 0, array_size, array_size) == 0;
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            read_time = elapsed(start, stop);
+            same &= memcmp(back, src, bytes) == 0;
+
+            // An off-centre, tile-unaligned square of 1/64 of the grid
+            long i0 = array_size / 3 + 1, j0 = array_size / 5 + 3;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            same &= grid_file_read(path, part, i0, j0, sub, sub) == 0;
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            rect_time = elapsed(start, stop);
+            for (long j = 0; j < sub; j++) {
+                same &= memcmp(part + j * sub, src + i0 + (j0 + j) * array_size, sub * sizeof(float)) == 0;
+            }
+
+            printf("%-5c %-10s %8.2f %10.3f %10.3f %10.2f %12.4f %9s\n", which == 0 ? 'x' : 'y',
+                   grid_codec_name(codec), (double) bytes / st.st_size, write_time, read_time,
+                   bytes / 1073741824.0 / read_time, rect_time, same ? "yes" : "NO");
+            unlink(path);
+        }
+    }
+
+    grid_free(x);
+    grid_free(y);
+    grid_free(back);
+    free(part);
+}
@@ -0,0 +1,120 @@
+// Benchmark: packed threshold masks against count()
+//
+// usage: a.out_bench_mask [array_size] [reps]
+// Builds the masks of x and y with every supported kernel, checks the bits
+// and popcounts against the scalar kernel and count(), and times the
+// AND / OR / ANDNOT combinations of the two masks.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    const long array_size = argc > 1 ? atol(argv[1]) : 8194;
+    const int reps = argc > 2 ? atoi(argv[2]) : 5;
+
+    size_t bytes = array_size * array_size * sizeof(float);
+    size_t mask_bytes = mask_words(array_size) * array_size * sizeof(uint64_t);
+    struct timespec start, stop;
+    long x_below, y_below;
+    double count_time = 1.0e30;
+
+    float *x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    uint64_t *x_ref = (uint64_t *) grid_alloc(array_size, mask_words(array_size) * sizeof(uint64_t));
+    uint64_t *x_mask = (uint64_t *) grid_alloc(array_size, mask_words(array_size) * sizeof(uint64_t));
+    uint64_t *y_mask = (uint64_t *) grid_alloc(array_size, mask_words(array_size) * sizeof(uint64_t));
+    uint64_t *z_mask = (uint64_t *) grid_alloc(array_size, mask_words(array_size) * sizeof(uint64_t));
+
+    if (x == NULL || y == NULL || x_ref == NULL || x_mask == NULL || y_mask == NULL || z_mask == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    initialize(x, array_size);
+    copy_border(x, y, array_size);
+    smooth(x, y, array_size, a, b, c);
+    count(y, array_size, threshold, &y_below);
+    for (int r = 0; r < reps; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        count(x, array_size, threshold, &x_below);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        count_time = elapsed(start, stop) < count_time ? elapsed(start, stop) : count_time;
+    }
+    mask_build(x_ref, x, array_size, threshold, "scalar");
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %.1f MB vs %.1f MB (%.1fx)\n", "Mask vs float grid",
+           mask_bytes / 1048576.0, bytes / 1048576.0, (double) bytes / mask_bytes);
+    #ifdef _OPENMP
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    printf("\n%-10s %10s %10s %12s %10s\n", "kernel", "time (s)", "GB/s", "count ok", "bits ok");
+    printf("%-10s %10.4f %10.2f %12s %10s\n", "count()", count_time, bytes / 1073741824.0 / count_time, "-", "-");
+
+    static const char *names[] = { "scalar", "avx2", "avx512" };
+    for (int k = 0; k < 3; k++) {
+        int which;
+        if (mask_kernel_select(names[k], &which) == NULL) {
+            continue;
+        }
+
+        double t = 1.0e30;
+        long below = 0;
+        for (int r = 0; r < reps; r++) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            below = mask_build(x_mask, x, array_size, threshold, names[k]);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            t = elapsed(start, stop) < t ? elapsed(start, stop) : t;
+        }
+        printf("%-10s %10.4f %10.2f %12s %10s\n", names[k], t, bytes / 1073741824.0 / t,
+               below == x_below ? "yes" : "NO", memcmp(x_mask, x_ref, mask_bytes) == 0 ? "yes" : "NO");
+    }
+
+    // Combinations of the x and y masks
+    long got_y = mask_build(y_mask, y, array_size, threshold, NULL);
+    printf("\n%-45s: %s\n", "Mask popcount of y matches count()", got_y == y_below ? "yes" : "NO");
+
+    static const char *ops[] = { "x AND y", "x OR y", "y ANDNOT x (dropped below)" };
+    for (int op = MASK_AND; op <= MASK_ANDNOT; op++) {
+        const uint64_t *p = op == MASK_ANDNOT ? y_mask : x_mask;
+        const uint64_t *q = op == MASK_ANDNOT ? x_mask : y_mask;
+        double t = 1.0e30;
+        long got = 0, expect = 0;
+
+        for (int r = 0; r < reps; r++) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            got = mask_combine(z_mask, p, q, array_size, op);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            t = elapsed(start, stop) < t ? elapsed(start, stop) : t;
+        }
+
+        // Brute force over the float grids
+        for (long j = 1; j < array_size - 1; j++) {
+            for (long i = 1; i < array_size - 1; i++) {
+                int bx = x[i + j * array_size] < threshold, by = y[i + j * array_size] < threshold;
+                expect += op == MASK_AND ? bx & by : op == MASK_OR ? bx | by : by & !bx;
+            }
+        }
+
+        printf("%-45s: %ld in %.5f s (%s)\n", ops[op], got, t, got == expect ? "ok" : "MISMATCH");
+    }
+
+    grid_free(x);
+    grid_free(y);
+    grid_free(x_ref);
+    grid_free(x_mask);
+    grid_free(y_mask);
+    grid_free(z_mask);
+}
@@ -0,0 +1,144 @@
+// Benchmark: rectangle threshold counts from summed-area tables against brute-force scans
+//
+// usage: a.out_bench_sat [array_size] [queries] [block]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+// Cells of y below threshold in columns [i0, i1), rows [j0, j1), inner cells only
+static long brute_count(const float *array, long n, float threshold, long i0, long j0, long i1, long j1) {
+    long total = 0;
+    for (long j = j0 > 1 ? j0 : 1; j < j1 && j < n - 1; j++) {
+        for (long i = i0 > 1 ? i0 : 1; i < i1 && i < n - 1; i++) {
+            total += array[i + j * n] < threshold;
+        }
+    }
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    const long array_size = argc > 1 ? atol(argv[1]) : 8194;
+    const int queries = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 1000;
+    const int block = argc > 3 ? atoi(argv[3]) : 16;
+
+    struct timespec start, stop;
+    double sat_time, block_time, brute_time, sat_q_time, block_q_time;
+    double num_elements = (double) array_size * array_size;
+
+    float *x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    uint32_t *sat = (uint32_t *) grid_alloc(array_size + 1, (array_size + 1) * sizeof(uint32_t));
+    long *rects = (long *) malloc(4 * queries * sizeof(long));
+    long *expect = (long *) malloc(queries * sizeof(long));
+
+    if (x == NULL || y == NULL || sat == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    initialize(x, array_size);
+    copy_border(x, y, array_size);
+    smooth(x, y, array_size, a, b, c);
+
+    // Index builds
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status = sat_build(sat, y, array_size, threshold);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if (status != 0) {
+        printf("Allocation of the table build buffers failed!\n");
+        exit(-1);
+    }
+    sat_time = elapsed(start, stop);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sat_block_t *blk = sat_block_build(y, array_size, threshold, block);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if (blk == NULL) {
+        printf("Allocation of the block table failed!\n");
+        exit(-1);
+    }
+    block_time = elapsed(start, stop);
+
+    // Random rectangles with sides up to the whole grid
+    srand(12345);
+    for (int q = 0; q < queries; q++) {
+        long i0 = rand() % array_size, i1 = rand() % array_size;
+        long j0 = rand() % array_size, j1 = rand() % array_size;
+        rects[4 * q + 0] = i0 < i1 ? i0 : i1;
+        rects[4 * q + 1] = j0 < j1 ? j0 : j1;
+        rects[4 * q + 2] = (i0 < i1 ? i1 : i0) + 1;
+        rects[4 * q + 3] = (j0 < j1 ? j1 : j0) + 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int q = 0; q < queries; q++) {
+        const long *r = rects + 4 * q;
+        expect[q] = brute_count(y, array_size, threshold, r[0], r[1], r[2], r[3]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    brute_time = elapsed(start, stop);
+
+    int sat_ok = 1, block_ok = 1;
+    volatile long sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int q = 0; q < queries; q++) {
+        const long *r = rects + 4 * q;
+        long v = sat_query(sat, array_size, r[0], r[1], r[2], r[3]);
+        sat_ok &= v == expect[q];
+        sink += v;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    sat_q_time = elapsed(start, stop);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int q = 0; q < queries; q++) {
+        const long *r = rects + 4 * q;
+        long v = sat_block_query(blk, r[0], r[1], r[2], r[3]);
+        block_ok &= v == expect[q];
+        sink += v;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    block_q_time = elapsed(start, stop);
+
+    long y_below;
+    count(y, array_size, threshold, &y_below);
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %d\n", "Queries", queries);
+    #ifdef _OPENMP
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+    printf("%-45s: %.3f\n", "Full table bytes per cell", 4.0 * (array_size + 1) * (array_size + 1) / num_elements);
+    printf("%-45s: %.3f\n", "Block table bytes per cell",
+           (8.0 * blk->words * array_size + 8.0 * (blk->nblocks + 1) * (blk->nblocks + 1)) / num_elements);
+    printf("%-45s: %s %s\n", "Queries match brute force (full, block)",
+           sat_ok ? "yes" : "NO", block_ok ? "yes" : "NO");
+    printf("%-45s: %s\n", "Whole inner region matches count()",
+           sat_block_query(blk, 0, 0, array_size, array_size) == y_below ? "yes" : "NO");
+
+    printf("\n----- Action -----\n");
+    printf("%-25s: %.3f\n", "CPU: Build full table", sat_time);
+    printf("%-25s: %.3f\n", "CPU: Build block table", block_time);
+    printf("%-25s: %.3e\n", "CPU: Query brute force", brute_time / queries);
+    printf("%-25s: %.3e\n", "CPU: Query full table", sat_q_time / queries);
+    printf("%-25s: %.3e\n", "CPU: Query block table", block_q_time / queries);
+
+    sat_block_free(blk);
+    grid_free(x);
+    grid_free(y);
+    grid_free(sat);
+    free(rects);
+    free(expect);
+}
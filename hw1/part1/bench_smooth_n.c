@@ -0,0 +1,95 @@
+// Benchmark: temporally blocked smooth_n() against nsteps ping-pong smooth() calls
+//
+// usage: a.out_bench_smooth_n [array_size] [max_steps]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const long array_size = argc > 1 ? atol(argv[1]) : 8194;
+    const int max_steps = argc > 2 ? atoi(argv[2]) : 16;
+
+    size_t bytes = array_size * array_size * sizeof(float);
+    double num_in_elements = (double) (array_size - 2) * (array_size - 2);
+
+    struct timespec start, stop;
+
+    float *x0 = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *ref_x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *ref_y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+
+    if (x0 == NULL || ref_x == NULL || ref_y == NULL || x == NULL || y == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    initialize(x0, array_size);
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3f\n", "Memory (GB) used per array", bytes / 1073741824.0);
+    #ifdef _OPENMP
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    // Bandwidth is counted as the traffic the naive loop needs (read x,
+    // write y per sweep), so the fused engine reports an effective rate
+    printf("\n%6s %12s %12s %12s %12s %12s %12s %10s\n", "nsteps",
+           "naive (s)", "naive GB/s", "naive GUP/s",
+           "fused (s)", "fused GB/s", "fused GUP/s", "identical");
+
+    for (int nsteps = 1; nsteps <= max_steps; nsteps *= 2) {
+        double naive_time, fused_time;
+        double traffic = 2.0 * nsteps * bytes / 1073741824.0;
+        double updates = nsteps * num_in_elements / 1.0e9;
+
+        // Naive: nsteps full sweeps with ping-pong buffers
+        memcpy(ref_x, x0, bytes);
+        copy_border(ref_x, ref_y, array_size);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int s = 0; s < nsteps; s++) {
+            if (s % 2 == 0) {
+                smooth(ref_x, ref_y, array_size, a, b, c);
+            } else {
+                smooth(ref_y, ref_x, array_size, a, b, c);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        naive_time = elapsed(start, stop);
+        float *ref = nsteps % 2 ? ref_y : ref_x;
+
+        // Fused: temporally blocked
+        memcpy(x, x0, bytes);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (smooth_n(x, y, array_size, a, b, c, nsteps) != 0) {
+            printf("smooth_n: allocation of tile buffers failed!\n");
+            exit(-1);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        fused_time = elapsed(start, stop);
+
+        int identical = memcmp(ref, y, bytes) == 0;
+
+        printf("%6d %12.3f %12.2f %12.3f %12.3f %12.2f %12.3f %10s\n", nsteps,
+               naive_time, traffic / naive_time, updates / naive_time,
+               fused_time, traffic / fused_time, updates / fused_time,
+               identical ? "yes" : "NO");
+    }
+
+    grid_free(x0);
+    grid_free(ref_x);
+    grid_free(ref_y);
+    grid_free(x);
+    grid_free(y);
+}
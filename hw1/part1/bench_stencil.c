@@ -0,0 +1,103 @@
+// Benchmark: generic compile-time stencils against the hand-written smooth()
+//
+// usage: a.out_bench_stencil [array_size] [reps]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+// Best of reps runs
+static double time_apply(const stencil_t *s, const float *w, float *x, float *y, long n, int reps) {
+    struct timespec start, stop;
+    double best = 1.0e30;
+
+    for (int r = 0; r < reps; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        s->apply(x, y, n, w);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        best = elapsed(start, stop) < best ? elapsed(start, stop) : best;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const long array_size = argc > 1 ? atol(argv[1]) : 8194;
+    const int reps = argc > 2 ? atoi(argv[2]) : 5;
+
+    // Weights per shape, outermost group first; each set sums to 1
+    // over all taps.  The 9-point set is smooth()'s a, b, c.
+    const float w5[] = { 0.15, 0.4 };
+    const float w9[] = { a, b, c };
+    const float w13[] = { 0.025, 0.05, 0.1, 0.3 };
+    const float w25[] = { 0.01, 0.02, 0.03, 0.05, 0.1, 0.08 };
+    const float *weights[] = { w5, w9, w13, w25 };
+
+    size_t bytes = array_size * array_size * sizeof(float);
+    double traffic = 2.0 * bytes / 1073741824.0;
+
+    struct timespec start, stop;
+
+    float *x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *ref = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+
+    if (x == NULL || ref == NULL || y == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    initialize(x, array_size);
+    copy_border(x, ref, array_size);
+    copy_border(x, y, array_size);
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3f\n", "Memory (GB) used per array", bytes / 1073741824.0);
+    #ifdef _OPENMP
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    // Reference: hand-written smooth()
+    double smooth_time = 1.0e30;
+    for (int r = 0; r < reps; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        smooth(x, ref, array_size, a, b, c);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        smooth_time = elapsed(start, stop) < smooth_time ? elapsed(start, stop) : smooth_time;
+    }
+
+    // Bandwidth is the compulsory traffic (read x, write y) for every shape
+    printf("\n%-9s %6s %6s %12s %12s %12s %10s\n", "shape", "taps", "radius",
+           "time (s)", "GB/s", "GUP/s", "vs smooth");
+    printf("%-9s %6d %6d %12.4f %12.2f %12.3f %10s\n", "smooth()", 9, 1, smooth_time,
+           traffic / smooth_time, (array_size - 2.0) * (array_size - 2) / 1.0e9 / smooth_time, "-");
+
+    const stencil_t *s;
+    for (int k = 0; (s = stencil_get(k)) != NULL; k++) {
+        long inner = array_size - 2 * s->radius;
+        double t;
+
+        stencil_copy_border(x, y, array_size, s->radius);
+        t = time_apply(s, weights[k], x, y, array_size, reps);
+
+        printf("%-9s %6d %6d %12.4f %12.2f %12.3f %9.2fx\n", s->name, s->taps, s->radius, t,
+               traffic / t, (double) inner * inner / 1.0e9 / t, smooth_time / t);
+
+        if (strcmp(s->name, "9pt") == 0) {
+            printf("%-45s: %s\n", "9pt identical to smooth()",
+                   memcmp(ref, y, bytes) == 0 ? "yes" : "NO");
+        }
+    }
+
+    grid_free(x);
+    grid_free(ref);
+    grid_free(y);
+}
@@ -0,0 +1,101 @@
+// Benchmark: incremental re-smoothing of small updates against a full re-run
+//
+// usage: a.out_bench_tiled [array_size] [updates] [rect] [tile]
+//   each update overwrites a rect x rect block at a random position of x
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    const long array_size = argc > 1 ? atol(argv[1]) : 8194;
+    const int updates = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 100;
+    const long rect = argc > 3 ? atol(argv[3]) : 64;
+    const int tile = argc > 4 ? atoi(argv[4]) : 128;
+
+    struct timespec start, stop;
+    double build_time, full_time, update_time = 0;
+    long tiles_done = 0;
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %d x %d\n", "Tile size", tile, tile);
+    printf("%-45s: %d of %ld x %ld\n", "Updates", updates, rect, rect);
+    #ifdef _OPENMP
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tile_grid_t *g = tile_grid_create(array_size, tile, a, b, c, threshold);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    build_time = elapsed(start, stop);
+    if (g == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    // Updates: random blocks of values around the threshold
+    float *block = (float *) malloc(rect * rect * sizeof(float));
+    if (block == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+    srand(12345);
+    for (int u = 0; u < updates; u++) {
+        long i0 = rand() % (array_size - rect + 1);
+        long j0 = rand() % (array_size - rect + 1);
+        for (long k = 0; k < rect * rect; k++) {
+            block[k] = (float) rand() / RAND_MAX * 0.4f;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (tile_grid_write(g, i0, j0, rect, rect, block, rect) != 0) {
+            printf("Update of %ld x %ld at (%ld, %ld) failed!\n", rect, rect, i0, j0);
+            exit(-1);
+        }
+        tiles_done += tile_grid_refresh(g);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        update_time += elapsed(start, stop);
+    }
+    free(block);
+
+    // Reference: full smooth and counts over the updated x
+    float *y_ref = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    long x_ref, y_ref_below;
+    if (y_ref == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    copy_border(g->x, y_ref, array_size);
+    smooth(g->x, y_ref, array_size, a, b, c);
+    count(g->x, array_size, threshold, &x_ref);
+    count(y_ref, array_size, threshold, &y_ref_below);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    full_time = elapsed(start, stop);
+
+    printf("\n%-45s: %ld %ld\n", "Counts below threshold (x, y)", g->x_below, g->y_below);
+    printf("%-45s: %s\n", "Counts match a full recount",
+           x_ref == g->x_below && y_ref_below == g->y_below ? "yes" : "NO");
+    printf("%-45s: %s\n", "y identical to a full smooth",
+           memcmp(y_ref, g->y, array_size * array_size * sizeof(float)) == 0 ? "yes" : "NO");
+    printf("%-45s: %.1f\n", "Tiles re-smoothed per update", (double) tiles_done / updates);
+
+    printf("\n----- Action -----\n");
+    printf("%-25s: %.3f\n", "CPU: Build (full)", build_time);
+    printf("%-25s: %.3f\n", "CPU: Full re-run", full_time);
+    printf("%-25s: %.6f\n", "CPU: Per update", update_time / updates);
+    printf("%-25s: %.1fx\n", "Speedup per update", full_time / (update_time / updates));
+
+    grid_free(y_ref);
+    tile_grid_free(g);
+}
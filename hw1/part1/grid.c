@@ -0,0 +1,97 @@
+// Baseline initialize / smooth / count kernels
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+void initialize(float *array, long array_size) {
+    #pragma omp parallel for collapse(2) schedule(static)
+        for (int j = 0; j < array_size; j++) {
+            for (int i = 0; i < array_size; i++) {
+                array[i + j * array_size] = grid_value(i, j);
+            }
+        }
+}
+
+void smooth(float *array, float *out_array, long array_size, float a, float b, float c) {
+    #pragma omp parallel for collapse(2) schedule(static)
+        for (int j = 1; j < array_size - 1; j++) {
+            for (int i = 1; i < array_size - 1; i++) {
+                out_array[i + j * array_size] = 
+                    a * (array[(i - 1) + (j - 1) * array_size] +
+                        array[(i - 1) + (j + 1) * array_size] +
+                        array[(i + 1) + (j - 1) * array_size] +
+                        array[(i + 1) + (j + 1) * array_size]) +
+                    b * (array[(i - 1) + j * array_size] +
+                        array[(i + 1) + j * array_size] +
+                        array[i + (j - 1) * array_size] +
+                        array[i + (j + 1) * array_size]) +
+                    c * (array[i + j * array_size]);
+            }
+        }
+} 
+
+void count(float *array, long array_size, float threshold, long *below_threshold) {
+    long temp = 0;
+
+    #pragma omp parallel for collapse(2) reduction(+:temp) schedule(static)
+        for (int j = 1; j < array_size - 1; j++) {
+            for (int i = 1; i < array_size - 1; i++) {
+                if (array[i + j * array_size] < threshold) {
+                    temp++;
+                }
+            }
+        }
+    *below_threshold = temp;
+}
+
+// Copy the fixed outer ring of array into out_array.  smooth() never writes
+// the border, so repeated sweeps need both buffers to share it.
+void copy_border(float *array, float *out_array, long array_size) {
+    memcpy(out_array, array, array_size * sizeof(float));
+    memcpy(out_array + (array_size - 1) * array_size,
+           array + (array_size - 1) * array_size, array_size * sizeof(float));
+
+    #pragma omp parallel for schedule(static)
+        for (long j = 1; j < array_size - 1; j++) {
+            out_array[j * array_size] = array[j * array_size];
+            out_array[array_size - 1 + j * array_size] = array[array_size - 1 + j * array_size];
+        }
+}
+
+// Fused smooth + count: one pass over x produces y and the below-threshold
+// counts of both arrays.  x is counted as each centre value is loaded for
+// the stencil and y while the smoothed value is still in a register.
+void smooth_count(float *array, float *out_array, long array_size, float a, float b, float c,
+                  float threshold, long *x_below_threshold, long *y_below_threshold) {
+    long x_total = 0;
+    long y_total = 0;
+
+    #pragma omp parallel
+    {
+        // Per-thread partial counters, merged once at the end
+        long x_part = 0;
+        long y_part = 0;
+
+        #pragma omp for schedule(static)
+            for (long j = 1; j < array_size - 1; j++) {
+                const float *row = array + j * array_size;
+                float *out_row = out_array + j * array_size;
+                for (long i = 1; i < array_size - 1; i++) {
+                    float value = stencil9(row + i, array_size, a, b, c);
+                    out_row[i] = value;
+                    x_part += row[i] < threshold;
+                    y_part += value < threshold;
+                }
+            }
+
+        #pragma omp atomic
+        x_total += x_part;
+        #pragma omp atomic
+        y_total += y_part;
+    }
+
+    *x_below_threshold = x_total;
+    *y_below_threshold = y_total;
+}
@@ -0,0 +1,195 @@
+// Header File for the smoothing kernels shared by the part1 drivers
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Seconds elapsed between two clock_gettime samples
+static inline double elapsed(struct timespec start, struct timespec stop) {
+    return (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) / 1000000000;
+}
+
+// Value of the input grid at column i, row j
+static inline float grid_value(int i, int j) {
+    return (float)abs(i % 11 - j % 5) / (i % 7 + j % 3 + 1);
+}
+
+// 9-point stencil at p, with rows `stride` floats apart.  The summation order
+// is the one used by smooth(), so every caller produces bit-identical values.
+static inline float stencil9(const float *p, long stride, float a, float b, float c) {
+    return a * (p[-1 - stride] + p[-1 + stride] + p[1 - stride] + p[1 + stride]) +
+           b * (p[-1] + p[1] + p[-stride] + p[stride]) +
+           c * p[0];
+}
+
+// grid.c: baseline kernels
+void initialize(float *, long);
+void smooth(float *, float *, long, float, float, float);
+void count(float *, long, float, long *);
+void copy_border(float *, float *, long);
+void smooth_count(float *, float *, long, float, float, float, float, long *, long *);
+
+// smooth_simd.c: SSE/AVX2/AVX-512 kernels picked at startup from cpuid
+typedef struct {
+    const char *name;
+    void (*smooth)(float *, float *, long, float, float, float);
+    int (*supported)(void);
+} smooth_kernel_t;
+
+const smooth_kernel_t *smooth_kernel_select(const char *);
+const smooth_kernel_t *smooth_kernel_get(int);
+
+// smooth_inplace.c: overwrite x with its smoothed values, one grid of memory;
+// -1 if the per-thread row buffers cannot be allocated
+int smooth_inplace(float *, long, float, float, float);
+
+// smooth_n.c: temporally blocked multi-sweep smoother
+#define SMOOTH_N_MAX_FUSE 8
+int smooth_n(float *, float *, long, float, float, float, int);     // -1: no memory for the tile buffers
+
+// grid_half.c: 16-bit storage, fp32 compute
+typedef enum { STORE_FP32, STORE_FP16, STORE_BF16 } storage_t;
+
+const char *storage_name(storage_t);
+int storage_parse(const char *, storage_t *);
+// The kernels return -1 if their fp32 row buffers cannot be allocated
+int initialize_h(uint16_t *, long, storage_t);
+int smooth_h(uint16_t *, uint16_t *, long, float, float, float, storage_t);
+int count_h(uint16_t *, long, float, storage_t, long *);
+
+// grid_ooc.c: out-of-core smoothing over memory-mapped files
+long ooc_band_rows(long, long);
+int ooc_initialize(const char *, long, long);
+int ooc_smooth_count(const char *, const char *, long, long, float, float, float, float, long *, long *);
+
+// grid_proc.c: periodic procedural input, x is never stored
+typedef struct {
+    int pi, pj;                 // period along columns / rows
+    float (*gen)(int, int);     // generator, gen(i, j) = x[i + j * n]
+} proc_grid_t;
+
+int proc_detect_period(float (*)(int, int), int, proc_grid_t *);
+long proc_count(const proc_grid_t *, long, float);
+int proc_smooth_count(const proc_grid_t *, float *, long, float, float, float, float, long *);   // -1: no memory for the row table
+
+// stencil.c: generic symmetric stencils specialised per shape (stencil_tmpl.h)
+typedef struct {
+    const char *name;
+    int taps;
+    int radius;                 // border rings left untouched
+    int ngroups;                // weights, one per symmetry class of taps
+    void (*apply)(const float *, float *, long, const float *);
+} stencil_t;
+
+const stencil_t *stencil_get(int);
+const stencil_t *stencil_find(const char *);
+void stencil_copy_border(float *, float *, long, int);
+void smooth_stencil9(float *, float *, long, float, float, float);
+
+// grid_tiled.c: dirty-tile tracking and incrementally maintained counts
+typedef struct {
+    long n;
+    int tile;                   // tile edge in cells
+    long ntiles;                // tiles per row/column
+    float a, b, c, threshold;
+    float *x, *y;               // full row-major arrays
+    long *x_count, *y_count;    // per-tile inner cells below threshold
+    unsigned char *x_dirty, *y_dirty;
+    long *x_list, *y_list;      // the dirty tiles, each listed once
+    long nx_dirty, ny_dirty;
+    long x_below, y_below;      // totals over all tiles
+} tile_grid_t;
+
+tile_grid_t *tile_grid_create(long, int, float, float, float, float);
+void tile_grid_free(tile_grid_t *);
+int tile_grid_write(tile_grid_t *, long, long, long, long, const float *, long);
+long tile_grid_refresh(tile_grid_t *);
+
+// grid_mask.c: 1-bit-per-cell threshold masks (SIMD compare + popcount)
+enum { MASK_AND, MASK_OR, MASK_ANDNOT };
+
+long mask_words(long);
+const char *mask_kernel_select(const char *, int *);
+long mask_build(uint64_t *, const float *, long, float, const char *);
+long mask_popcount(const uint64_t *, long);
+long mask_combine(uint64_t *, const uint64_t *, const uint64_t *, long, int);
+
+// grid_sat.c: summed-area tables for rectangle threshold counts
+typedef struct {
+    long n;
+    int block;                  // B, cells per block edge
+    long nblocks;               // blocks per row/column
+    long words;                 // 64-bit words per bitmap row
+    uint64_t *bits;             // below-threshold mask, see grid_mask.c
+    uint64_t *bsat;             // (nblocks + 1)^2 block summed-area table
+} sat_block_t;
+
+int sat_build(uint32_t *, const float *, long, float);         // -1: no memory for the band carries
+long sat_query(const uint32_t *, long, long, long, long, long);
+sat_block_t *sat_block_build(const float *, long, float, int);
+void sat_block_free(sat_block_t *);
+long sat_block_query(const sat_block_t *, long, long, long, long);
+
+// grid_tasks.c: init -> smooth -> count as a tile-level OpenMP task graph
+enum { TASK_INIT, TASK_COUNT_X, TASK_SMOOTH, TASK_COUNT_Y, TASK_NPHASES };
+
+typedef struct {
+    double start, stop;         // omp_get_wtime() around one task
+} task_span_t;
+
+typedef struct {
+    long ntiles;
+    double origin;              // omp_get_wtime() when the graph started
+    task_span_t *spans;         // TASK_NPHASES x ntiles, caller frees
+} task_trace_t;
+
+int task_smooth_count(float *, float *, long, long, long, float, float, float, float,
+                      long *, long *, task_trace_t *);     // -1: no memory for the tile bookkeeping
+void task_trace_phase(const task_trace_t *, int, double *, double *, double *);
+
+// grid_file.c: chunked binary grid files with per-tile compression
+enum { GRID_DTYPE_F32 = 1 };
+enum { GRID_CODEC_NONE, GRID_CODEC_SHUFFLE_LZ, GRID_CODEC_XOR_LZ };
+
+typedef struct {
+    char magic[8];              // "PCSEGRID", no terminator
+    uint32_t version, dtype, codec;
+    uint32_t tile_rows, tile_cols, reserved;
+    uint64_t rows, cols, ntiles;
+    uint64_t index_offset;      // ntiles grid_file_tile_t entries
+} grid_file_header_t;
+
+typedef struct {
+    uint64_t offset;            // blob position in the file
+    uint32_t size;              // stored bytes
+    uint32_t codec;             // may be GRID_CODEC_NONE if the tile did not shrink
+} grid_file_tile_t;
+
+const char *grid_codec_name(int);
+int grid_codec_parse(const char *, int *);
+int grid_file_write(const char *, const float *, long, long, int, int, int);
+int grid_file_info(const char *, grid_file_header_t *);
+int grid_file_read(const char *, float *, long, long, long, long);
+
+// grid_hist.c: one-pass histogram + quantile sketch
+typedef struct {
+    int nedges;
+    float *edges;               // sorted bin edges
+    long *counts;               // nedges + 1 bins, see bin_of()
+    int *lookup;                // fine cell -> first candidate bin
+    int lookup_cells;
+    float lookup_lo, lookup_scale;
+    long *sketch;               // log-linear bucket counts
+    long total;
+} grid_hist_t;
+
+grid_hist_t *grid_hist_create(float, float, int, const float *, int);
+void grid_hist_free(grid_hist_t *);
+int grid_hist_build(grid_hist_t *, const float *, long);      // -1: no memory for the per-thread counters
+void grid_hist_merge(grid_hist_t *, const grid_hist_t *);
+long grid_hist_count_below(const grid_hist_t *, float, int *);
+float grid_hist_quantile(const grid_hist_t *, double);
+
+#endif
@@ -0,0 +1,456 @@
+// Chunked binary grid files
+//
+// Layout (native byte order):
+//   grid_file_header_t                       64 bytes
+//   grid_file_tile_t index[ntiles]           offset/size/codec of every tile
+//   tile blobs                               row-major tile order
+// A tile is tile_rows x tile_cols floats (smaller at the right/bottom
+// edge), compressed on its own so any subset of tiles can be read back.
+// Codecs, chosen per file and recorded per tile:
+//   GRID_CODEC_NONE        raw floats
+//   GRID_CODEC_SHUFFLE_LZ  byte-shuffle (all first bytes, then all second
+//                          bytes, ...) followed by a small LZ77 coder
+//   GRID_CODEC_XOR_LZ      each value XOR-ed with its left neighbour's bits
+//                          before shuffle + LZ (lossless fp delta coding)
+// A tile that does not shrink is stored raw and marked GRID_CODEC_NONE.
+//
+// Both directions are parallel over tiles with pread/pwrite.  Writes go in
+// batches: the tiles of a batch are encoded in parallel, their offsets are
+// assigned by a prefix sum over the encoded sizes, then they are written in
+// parallel and the index is written last.
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include "grid.h"
+
+#define GRID_FILE_MAGIC   "PCSEGRID"
+#define GRID_FILE_VERSION 1
+#define GRID_FILE_MAX_DIM (1UL << 31)    // rows/cols; keeps rows * cols in a long
+#define LZ_HASH_BITS      14
+#define LZ_MIN_MATCH      4
+#define LZ_MAX_OFFSET     65535
+
+// ---------------------------------------------------------------- LZ coder
+//
+// Stream of sequences: varint literal count, the literals, varint match
+// length (0 ends the stream), 16-bit match offset.
+
+static size_t put_varint(uint8_t *dst, size_t pos, size_t cap, size_t v) {
+    while (pos < cap) {
+        dst[pos++] = (v & 0x7f) | (v >= 0x80 ? 0x80 : 0);
+        if (v < 0x80) {
+            return pos;
+        }
+        v >>= 7;
+    }
+    return cap + 1;
+}
+
+static size_t get_varint(const uint8_t *src, size_t *pos, size_t n) {
+    size_t v = 0;
+    for (int shift = 0; *pos < n && shift < 64; shift += 7) {
+        uint8_t byte = src[(*pos)++];
+        v |= (size_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return v;
+        }
+    }
+    return (size_t) -1;
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Encoded size, or 0 when the output would not fit in cap bytes
+static size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap, uint32_t *table) {
+    size_t i = 0, anchor = 0, pos = 0;
+
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+    while (i + LZ_MIN_MATCH <= n) {
+        uint32_t h = (read32(src + i) * 2654435761u) >> (32 - LZ_HASH_BITS);
+        size_t cand = table[h];
+        table[h] = i + 1;
+
+        if (cand == 0 || i - (cand - 1) > LZ_MAX_OFFSET || read32(src + cand - 1) != read32(src + i)) {
+            i++;
+            continue;
+        }
+        cand--;
+
+        size_t len = LZ_MIN_MATCH;
+        while (i + len < n && src[cand + len] == src[i + len]) {
+            len++;
+        }
+
+        pos = put_varint(dst, pos, cap, i - anchor);
+        if (pos + (i - anchor) > cap) {
+            return 0;
+        }
+        memcpy(dst + pos, src + anchor, i - anchor);
+        pos = put_varint(dst, pos + (i - anchor), cap, len);
+        if (pos + 2 > cap) {
+            return 0;
+        }
+        dst[pos++] = (i - cand) & 0xff;
+        dst[pos++] = (i - cand) >> 8;
+
+        i += len;
+        anchor = i;
+    }
+
+    pos = put_varint(dst, pos, cap, n - anchor);
+    if (pos + (n - anchor) > cap) {
+        return 0;
+    }
+    memcpy(dst + pos, src + anchor, n - anchor);
+    pos = put_varint(dst, pos + (n - anchor), cap, 0);
+    return pos > cap ? 0 : pos;
+}
+
+static int lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t out_n) {
+    size_t pos = 0, out = 0;
+
+    for (;;) {
+        size_t lit = get_varint(src, &pos, n);
+        if (lit > n - pos || lit > out_n - out) {
+            return -1;
+        }
+        memcpy(dst + out, src + pos, lit);
+        pos += lit;
+        out += lit;
+
+        size_t len = get_varint(src, &pos, n);
+        if (len == 0) {
+            return out == out_n ? 0 : -1;
+        }
+        if (len == (size_t) -1 || pos + 2 > n) {
+            return -1;
+        }
+        size_t offset = src[pos] | (size_t) src[pos + 1] << 8;
+        pos += 2;
+        if (offset == 0 || offset > out || len > out_n - out) {
+            return -1;
+        }
+        // Byte by byte: source and destination may overlap
+        for (size_t k = 0; k < len; k++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+}
+
+// ---------------------------------------------------------------- tile codecs
+
+static void shuffle(const uint8_t *src, uint8_t *dst, size_t count) {
+    for (size_t e = 0; e < count; e++) {
+        for (int k = 0; k < 4; k++) {
+            dst[k * count + e] = src[4 * e + k];
+        }
+    }
+}
+
+static void unshuffle(const uint8_t *src, uint8_t *dst, size_t count) {
+    for (size_t e = 0; e < count; e++) {
+        for (int k = 0; k < 4; k++) {
+            dst[4 * e + k] = src[k * count + e];
+        }
+    }
+}
+
+// XOR each value with its left neighbour within a tile row (in place)
+static void xor_delta(uint32_t *v, long rows, long cols) {
+    for (long j = 0; j < rows; j++) {
+        for (long i = cols - 1; i > 0; i--) {
+            v[i + j * cols] ^= v[i - 1 + j * cols];
+        }
+    }
+}
+
+static void xor_undelta(uint32_t *v, long rows, long cols) {
+    for (long j = 0; j < rows; j++) {
+        for (long i = 1; i < cols; i++) {
+            v[i + j * cols] ^= v[i - 1 + j * cols];
+        }
+    }
+}
+
+// Per-thread scratch for one tile
+typedef struct {
+    uint8_t *raw, *tmp, *blob;
+    size_t cap;
+    uint32_t *table;
+} tile_buf_t;
+
+static int tile_buf_init(tile_buf_t *b, size_t raw_bytes) {
+    b->cap = raw_bytes + raw_bytes / 2 + 64;
+    b->raw = (uint8_t *) malloc(raw_bytes);
+    b->tmp = (uint8_t *) malloc(raw_bytes);
+    b->blob = (uint8_t *) malloc(b->cap);
+    b->table = (uint32_t *) malloc(sizeof(uint32_t) << LZ_HASH_BITS);
+    return b->raw && b->tmp && b->blob && b->table ? 0 : -1;
+}
+
+static void tile_buf_free(tile_buf_t *b) {
+    free(b->raw);
+    free(b->tmp);
+    free(b->blob);
+    free(b->table);
+}
+
+static void tile_bufs_free(tile_buf_t *bufs, int nthreads) {
+    if (bufs != NULL) {
+        for (int k = 0; k < nthreads; k++) {
+            tile_buf_free(&bufs[k]);
+        }
+        free(bufs);
+    }
+}
+
+// One scratch per thread of a team of up to nthreads, or NULL if any allocation fails
+static tile_buf_t *tile_bufs_alloc(int nthreads, size_t raw_bytes) {
+    tile_buf_t *bufs = (tile_buf_t *) calloc(nthreads, sizeof(tile_buf_t));
+    int status = bufs ? 0 : -1;
+
+    for (int k = 0; status == 0 && k < nthreads; k++) {
+        status = tile_buf_init(&bufs[k], raw_bytes);
+    }
+    if (status != 0) {
+        tile_bufs_free(bufs, nthreads);
+        return NULL;
+    }
+    return bufs;
+}
+
+// Encode b->raw (rows x cols floats) into b->blob; returns the size and sets *codec
+static size_t encode_tile(tile_buf_t *b, long rows, long cols, int requested, uint32_t *codec) {
+    size_t raw_bytes = rows * cols * sizeof(float);
+    size_t size = 0;
+
+    if (requested != GRID_CODEC_NONE) {
+        if (requested == GRID_CODEC_XOR_LZ) {
+            xor_delta((uint32_t *) b->raw, rows, cols);
+        }
+        shuffle(b->raw, b->tmp, rows * cols);
+        size = lz_compress(b->tmp, raw_bytes, b->blob, raw_bytes - 1, b->table);
+        if (size == 0 && requested == GRID_CODEC_XOR_LZ) {
+            xor_undelta((uint32_t *) b->raw, rows, cols);
+        }
+    }
+    if (size == 0) {
+        memcpy(b->blob, b->raw, raw_bytes);
+        *codec = GRID_CODEC_NONE;
+        return raw_bytes;
+    }
+    *codec = requested;
+    return size;
+}
+
+static int decode_tile(tile_buf_t *b, size_t size, long rows, long cols, uint32_t codec) {
+    size_t raw_bytes = rows * cols * sizeof(float);
+
+    switch (codec) {
+    case GRID_CODEC_NONE:
+        if (size != raw_bytes) {
+            return -1;
+        }
+        memcpy(b->raw, b->blob, raw_bytes);
+        return 0;
+    case GRID_CODEC_SHUFFLE_LZ:
+    case GRID_CODEC_XOR_LZ:
+        if (lz_decompress(b->blob, size, b->tmp, raw_bytes) != 0) {
+            return -1;
+        }
+        unshuffle(b->tmp, b->raw, rows * cols);
+        if (codec == GRID_CODEC_XOR_LZ) {
+            xor_undelta((uint32_t *) b->raw, rows, cols);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------- files
+
+const char *grid_codec_name(int codec) {
+    switch (codec) {
+    case GRID_CODEC_NONE:       return "none";
+    case GRID_CODEC_SHUFFLE_LZ: return "shuffle-lz";
+    case GRID_CODEC_XOR_LZ:     return "xor-lz";
+    }
+    return "?";
+}
+
+int grid_codec_parse(const char *name, int *codec) {
+    for (int k = GRID_CODEC_NONE; k <= GRID_CODEC_XOR_LZ; k++) {
+        if (strcmp(name, grid_codec_name(k)) == 0) {
+            *codec = k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Rows/columns of tile t
+static void tile_extent(const grid_file_header_t *h, long t, long *i0, long *j0, long *w, long *hgt) {
+    long ntx = (h->cols + h->tile_cols - 1) / h->tile_cols;
+    *i0 = (t % ntx) * h->tile_cols;
+    *j0 = (t / ntx) * h->tile_rows;
+    *w = *i0 + h->tile_cols < (long) h->cols ? h->tile_cols : (long) h->cols - *i0;
+    *hgt = *j0 + h->tile_rows < (long) h->rows ? h->tile_rows : (long) h->rows - *j0;
+}
+
+int grid_file_write(const char *path, const float *array, long rows, long cols,
+                    int tile_rows, int tile_cols, int codec) {
+    grid_file_header_t h = { GRID_FILE_MAGIC, GRID_FILE_VERSION, GRID_DTYPE_F32, codec,
+                             tile_rows, tile_cols, 0, rows, cols, 0, sizeof(grid_file_header_t) };
+    h.ntiles = ((rows + tile_rows - 1) / tile_rows) * ((cols + tile_cols - 1) / tile_cols);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    grid_file_tile_t *index = (grid_file_tile_t *) calloc(h.ntiles, sizeof(grid_file_tile_t));
+    int nthreads = omp_get_max_threads();
+    long batch = 4 * nthreads;
+    size_t raw_bytes = (size_t) tile_rows * tile_cols * sizeof(float);
+    size_t cap = raw_bytes + 64;
+    uint8_t *blobs = (uint8_t *) malloc(batch * cap);
+    tile_buf_t *bufs = tile_bufs_alloc(nthreads, raw_bytes);     // reused by every batch
+    off_t cursor = sizeof(h) + h.ntiles * sizeof(grid_file_tile_t);
+    int status = index && blobs && bufs ? 0 : -1;
+
+    for (long t0 = 0; status == 0 && t0 < (long) h.ntiles; t0 += batch) {
+        long t1 = t0 + batch < (long) h.ntiles ? t0 + batch : (long) h.ntiles;
+
+        // Encode the batch
+        #pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+            for (long t = t0; t < t1; t++) {
+                tile_buf_t *b = &bufs[omp_get_thread_num()];
+                long i0, j0, w, hgt;
+                tile_extent(&h, t, &i0, &j0, &w, &hgt);
+                for (long j = 0; j < hgt; j++) {
+                    memcpy(b->raw + j * w * sizeof(float), array + i0 + (j0 + j) * cols, w * sizeof(float));
+                }
+                index[t].size = encode_tile(b, hgt, w, codec, &index[t].codec);
+                memcpy(blobs + (t - t0) * cap, b->blob, index[t].size);
+            }
+
+        // Offsets, then write the batch
+        for (long t = t0; t < t1; t++) {
+            index[t].offset = cursor;
+            cursor += index[t].size;
+        }
+        #pragma omp parallel for reduction(|:status) schedule(dynamic)
+            for (long t = t0; t < t1; t++) {
+                if (pwrite(fd, blobs + (t - t0) * cap, index[t].size, index[t].offset) != (ssize_t) index[t].size) {
+                    status |= -1;
+                }
+            }
+    }
+
+    if (status == 0) {
+        size_t index_bytes = h.ntiles * sizeof(grid_file_tile_t);
+        if (pwrite(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) ||
+            pwrite(fd, index, index_bytes, h.index_offset) != (ssize_t) index_bytes) {
+            status = -1;
+        }
+    }
+
+    tile_bufs_free(bufs, nthreads);
+    free(index);
+    free(blobs);
+    close(fd);
+    return status;
+}
+
+// Header checks: the geometry must be non-empty and consistent with ntiles,
+// and the tile index must lie inside the file
+int grid_file_info(const char *path, grid_file_header_t *h) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = pread(fd, h, sizeof(*h), 0) == (ssize_t) sizeof(*h) && fstat(fd, &st) == 0 &&
+             memcmp(h->magic, GRID_FILE_MAGIC, sizeof(h->magic)) == 0 &&
+             h->version == GRID_FILE_VERSION && h->dtype == GRID_DTYPE_F32;
+    close(fd);
+
+    ok = ok && h->tile_rows > 0 && h->tile_cols > 0 &&
+         h->rows > 0 && h->cols > 0 && h->rows <= GRID_FILE_MAX_DIM && h->cols <= GRID_FILE_MAX_DIM;
+    ok = ok && h->ntiles == ((h->rows + h->tile_rows - 1) / h->tile_rows) *
+                            ((h->cols + h->tile_cols - 1) / h->tile_cols);
+    ok = ok && h->index_offset >= sizeof(*h) && h->index_offset <= (uint64_t) st.st_size &&
+         h->ntiles <= ((uint64_t) st.st_size - h->index_offset) / sizeof(grid_file_tile_t);
+    return ok ? 0 : -1;
+}
+
+int grid_file_read(const char *path, float *dst, long i0, long j0, long w, long hgt) {
+    grid_file_header_t h;
+    if (grid_file_info(path, &h) != 0 || i0 < 0 || j0 < 0 ||
+        i0 + w > (long) h.cols || j0 + hgt > (long) h.rows || w <= 0 || hgt <= 0) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t index_bytes = h.ntiles * sizeof(grid_file_tile_t);
+    grid_file_tile_t *index = (grid_file_tile_t *) malloc(index_bytes);
+    if (index == NULL || pread(fd, index, index_bytes, h.index_offset) != (ssize_t) index_bytes) {
+        free(index);
+        close(fd);
+        return -1;
+    }
+
+    // Tiles overlapping the rectangle
+    long ntx = (h.cols + h.tile_cols - 1) / h.tile_cols;
+    long ti0 = i0 / h.tile_cols, ti1 = (i0 + w - 1) / h.tile_cols;
+    long tj0 = j0 / h.tile_rows, tj1 = (j0 + hgt - 1) / h.tile_rows;
+    long nx = ti1 - ti0 + 1, ntiles = nx * (tj1 - tj0 + 1);
+    size_t raw_bytes = (size_t) h.tile_rows * h.tile_cols * sizeof(float);
+    int nthreads = omp_get_max_threads();
+    tile_buf_t *bufs = tile_bufs_alloc(nthreads, raw_bytes);
+    int status = bufs ? 0 : -1;
+
+    if (status == 0) {
+        #pragma omp parallel for num_threads(nthreads) reduction(|:status) schedule(dynamic)
+            for (long k = 0; k < ntiles; k++) {
+                tile_buf_t *b = &bufs[omp_get_thread_num()];
+                long t = (ti0 + k % nx) + (tj0 + k / nx) * ntx;
+                long ti, tj, tw, th;
+                tile_extent(&h, t, &ti, &tj, &tw, &th);
+
+                if (status != 0 || index[t].size > b->cap ||
+                    pread(fd, b->blob, index[t].size, index[t].offset) != (ssize_t) index[t].size ||
+                    decode_tile(b, index[t].size, th, tw, index[t].codec) != 0) {
+                    status |= -1;
+                    continue;
+                }
+
+                // Copy the overlap of the tile and the rectangle
+                long ci0 = ti > i0 ? ti : i0, ci1 = ti + tw < i0 + w ? ti + tw : i0 + w;
+                long cj0 = tj > j0 ? tj : j0, cj1 = tj + th < j0 + hgt ? tj + th : j0 + hgt;
+                const float *tile = (const float *) b->raw;
+                for (long j = cj0; j < cj1; j++) {
+                    memcpy(dst + (ci0 - i0) + (j - j0) * w, tile + (ci0 - ti) + (j - tj) * tw,
+                           (ci1 - ci0) * sizeof(float));
+                }
+            }
+    }
+
+    tile_bufs_free(bufs, nthreads);
+    free(index);
+    close(fd);
+    return status;
+}
@@ -0,0 +1,307 @@
+// Reduced-precision (IEEE half / bfloat16) grid storage with fp32 compute
+//
+// Grids are stored as 16-bit values, halving footprint and traffic.  Each
+// thread converts the rows it needs into small fp32 row buffers (F16C,
+// AVX2 or AVX-512 BF16 when the CPU has them, a software path otherwise),
+// runs the stencil in fp32 with the same summation order as smooth(), and
+// rounds the result back to 16 bits (round to nearest even).  The row
+// buffers of all threads are allocated before each parallel region; the
+// kernels return -1, with nothing written, if that fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "grid.h"
+
+static const char *storage_names[] = { "fp32", "fp16", "bf16" };
+
+const char *storage_name(storage_t storage) {
+    return storage_names[storage];
+}
+
+int storage_parse(const char *name, storage_t *storage) {
+    for (int k = 0; k < 3; k++) {
+        if (strcmp(name, storage_names[k]) == 0) {
+            *storage = (storage_t) k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ---------- Software conversions ----------
+
+static inline uint32_t f32_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bits_f32(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static inline float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t man = h & 0x3ff;
+
+    if (exp == 0x1f) {
+        return bits_f32(sign | 0x7f800000 | (man << 13));
+    }
+    if (exp == 0) {
+        // Subnormal half: man * 2^-24
+        float f = (float) man * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    return bits_f32(sign | ((exp + 112) << 23) | (man << 13));
+}
+
+static inline uint16_t float_to_half(float f) {
+    uint32_t u = f32_bits(f);
+    uint16_t sign = (u >> 16) & 0x8000;
+    uint32_t abs_u = u & 0x7fffffff;
+
+    if (abs_u >= 0x7f800000) {
+        return sign | 0x7c00 | (abs_u > 0x7f800000 ? 0x200 : 0);
+    }
+    if (abs_u >= 0x477ff000) {
+        // Rounds to or beyond 65520: overflow to infinity
+        return sign | 0x7c00;
+    }
+    if (abs_u < 0x38800000) {
+        // Result is subnormal (or zero): scale so the float adder rounds
+        float scaled = bits_f32(abs_u) + 0.5f;
+        return sign | (uint16_t) (f32_bits(scaled) - 0x3f000000);
+    }
+    uint32_t mant_odd = (abs_u >> 13) & 1;
+    abs_u += 0xfff + mant_odd - (112u << 23);
+    return sign | (uint16_t) (abs_u >> 13);
+}
+
+static inline float bf16_to_float(uint16_t h) {
+    return bits_f32((uint32_t) h << 16);
+}
+
+static inline uint16_t float_to_bf16(float f) {
+    uint32_t u = f32_bits(f);
+    if ((u & 0x7fffffff) > 0x7f800000) {
+        return (u >> 16) | 0x40;
+    }
+    return (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+}
+
+static void load_half_sw(const uint16_t *src, float *dst, long n) {
+    for (long i = 0; i < n; i++) dst[i] = half_to_float(src[i]);
+}
+
+static void store_half_sw(const float *src, uint16_t *dst, long n) {
+    for (long i = 0; i < n; i++) dst[i] = float_to_half(src[i]);
+}
+
+static void load_bf16_sw(const uint16_t *src, float *dst, long n) {
+    for (long i = 0; i < n; i++) dst[i] = bf16_to_float(src[i]);
+}
+
+static void store_bf16_sw(const float *src, uint16_t *dst, long n) {
+    for (long i = 0; i < n; i++) dst[i] = float_to_bf16(src[i]);
+}
+
+// ---------- SIMD conversions ----------
+
+__attribute__((target("avx2,f16c")))
+static void load_half_f16c(const uint16_t *src, float *dst, long n) {
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (src + i))));
+    }
+    load_half_sw(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2,f16c")))
+static void store_half_f16c(const float *src, uint16_t *dst, long n) {
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *) (dst + i), h);
+    }
+    store_half_sw(src + i, dst + i, n - i);
+}
+
+// bf16 -> fp32 is a 16-bit left shift of each lane
+__attribute__((target("avx2")))
+static void load_bf16_avx2(const uint16_t *src, float *dst, long n) {
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i w = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(w, 16)));
+    }
+    load_bf16_sw(src + i, dst + i, n - i);
+}
+
+// Round-to-nearest-even in integer lanes; the grids hold no NaNs, which the
+// scalar tail handles anyway
+__attribute__((target("avx2")))
+static void store_bf16_avx2(const float *src, uint16_t *dst, long n) {
+    long i = 0;
+    const __m256i bias = _mm256_set1_epi32(0x7fff);
+    const __m256i one = _mm256_set1_epi32(1);
+    for (; i + 8 <= n; i += 8) {
+        __m256i u = _mm256_castps_si256(_mm256_loadu_ps(src + i));
+        __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16), one);
+        __m256i r = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(bias, odd)), 16);
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+        _mm_storeu_si128((__m128i *) (dst + i), packed);
+    }
+    store_bf16_sw(src + i, dst + i, n - i);
+}
+
+// vcvtneps2bf16 flushes fp32 subnormals to zero; grid values never get there
+__attribute__((target("avx512f,avx512bf16,avx512vl")))
+static void store_bf16_avx512(const float *src, uint16_t *dst, long n) {
+    long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256bh h = _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), (__m256i) h);
+    }
+    store_bf16_sw(src + i, dst + i, n - i);
+}
+
+typedef struct {
+    void (*load)(const uint16_t *, float *, long);
+    void (*store)(const float *, uint16_t *, long);
+} converter_t;
+
+static converter_t select_converter(storage_t storage) {
+    converter_t cv;
+
+    __builtin_cpu_init();
+    if (storage == STORE_FP16) {
+        int f16c = __builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx2");
+        cv.load = f16c ? load_half_f16c : load_half_sw;
+        cv.store = f16c ? store_half_f16c : store_half_sw;
+    } else {
+        int avx2 = __builtin_cpu_supports("avx2");
+        cv.load = avx2 ? load_bf16_avx2 : load_bf16_sw;
+        cv.store = __builtin_cpu_supports("avx512bf16") ? store_bf16_avx512
+                 : avx2 ? store_bf16_avx2 : store_bf16_sw;
+    }
+    return cv;
+}
+
+// ---------- Kernels ----------
+
+// nrows fp32 rows of array_size floats for each of nthreads threads
+static float *row_buffers(int nthreads, int nrows, long array_size) {
+    return (float *) malloc((size_t) nthreads * nrows * array_size * sizeof(float));
+}
+
+int initialize_h(uint16_t *array, long array_size, storage_t storage) {
+    converter_t cv = select_converter(storage);
+    int nthreads = omp_get_max_threads();
+    float *rows = row_buffers(nthreads, 1, array_size);
+
+    if (rows == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        float *row = rows + omp_get_thread_num() * array_size;
+
+        #pragma omp for schedule(static)
+            for (long j = 0; j < array_size; j++) {
+                for (long i = 0; i < array_size; i++) {
+                    row[i] = grid_value(i, j);
+                }
+                cv.store(row, array + j * array_size, array_size);
+            }
+    }
+
+    free(rows);
+    return 0;
+}
+
+int smooth_h(uint16_t *array, uint16_t *out_array, long array_size, float a, float b, float c,
+             storage_t storage) {
+    converter_t cv = select_converter(storage);
+
+    if (array_size < 3) {
+        return 0;
+    }
+
+    int nthreads = omp_get_max_threads();
+    float *buffers = row_buffers(nthreads, 4, array_size);
+    if (buffers == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int nt = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        long inner = array_size - 2;
+        long j0 = 1 + inner * tid / nt;
+        long j1 = 1 + inner * (tid + 1) / nt;
+
+        // Rolling fp32 copies of rows j-1, j, j+1 plus the output row
+        float *rows[3], *out = buffers + 4 * tid * array_size;
+        for (int k = 0; k < 3; k++) {
+            rows[k] = out + (k + 1) * array_size;
+        }
+
+        if (j0 < j1) {
+            cv.load(array + (j0 - 1) * array_size, rows[0], array_size);
+            cv.load(array + j0 * array_size, rows[1], array_size);
+        }
+
+        for (long j = j0; j < j1; j++) {
+            cv.load(array + (j + 1) * array_size, rows[2], array_size);
+            const float *up = rows[0], *mid = rows[1], *down = rows[2];
+            for (long i = 1; i < array_size - 1; i++) {
+                out[i] = a * (up[i - 1] + down[i - 1] + up[i + 1] + down[i + 1]) +
+                         b * (mid[i - 1] + mid[i + 1] + up[i] + down[i]) +
+                         c * mid[i];
+            }
+            cv.store(out + 1, out_array + j * array_size + 1, array_size - 2);
+            float *t = rows[0]; rows[0] = rows[1]; rows[1] = rows[2]; rows[2] = t;
+        }
+    }
+
+    free(buffers);
+    return 0;
+}
+
+int count_h(uint16_t *array, long array_size, float threshold, storage_t storage,
+            long *below_threshold) {
+    converter_t cv = select_converter(storage);
+    int nthreads = omp_get_max_threads();
+    float *rows = row_buffers(nthreads, 1, array_size);
+    long temp = 0;
+
+    if (rows == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(nthreads) reduction(+:temp)
+    {
+        float *row = rows + omp_get_thread_num() * array_size;
+
+        #pragma omp for schedule(static)
+            for (long j = 1; j < array_size - 1; j++) {
+                cv.load(array + j * array_size + 1, row, array_size - 2);
+                for (long i = 0; i < array_size - 2; i++) {
+                    temp += row[i] < threshold;
+                }
+            }
+    }
+
+    free(rows);
+    *below_threshold = temp;
+    return 0;
+}
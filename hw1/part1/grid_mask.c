@@ -0,0 +1,154 @@
+// Packed threshold masks: one bit per cell of `value < threshold`
+//
+// Row j of the mask is mask_words(n) 64-bit words; bit i of the row is
+// cell (i, j).  Only inner cells can be set, so the popcount of a mask is
+// exactly what count() returns.  The AVX2 kernel turns 8 compares into 8
+// bits with movemask, the AVX-512 kernel gets 16 bits straight from a mask
+// register; both fill a whole word before storing it, and the count comes
+// from popcount of the words just written.  At 1 bit per cell a mask is 32x
+// smaller than the float grid.  NaN compares false, as in count().
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "grid.h"
+
+// Fill the words of one row; cells [0, full) are done 64 at a time by the
+// vector kernels, the rest here
+typedef void (*mask_row_fn)(const float *, uint64_t *, long, float);
+
+static void mask_tail(const float *row, uint64_t *out, long from_word, long n, float threshold) {
+    for (long w = from_word; w * 64 < n; w++) {
+        uint64_t word = 0;
+        for (long i = w * 64; i < (w + 1) * 64 && i < n; i++) {
+            word |= (uint64_t) (row[i] < threshold) << (i & 63);
+        }
+        out[w] = word;
+    }
+}
+
+static void mask_row_scalar(const float *row, uint64_t *out, long n, float threshold) {
+    mask_tail(row, out, 0, n, threshold);
+}
+
+__attribute__((target("avx2")))
+static void mask_row_avx2(const float *row, uint64_t *out, long n, float threshold) {
+    __m256 vt = _mm256_set1_ps(threshold);
+    long w = 0;
+    for (; (w + 1) * 64 <= n; w++) {
+        uint64_t word = 0;
+        for (int k = 0; k < 8; k++) {
+            __m256 lt = _mm256_cmp_ps(_mm256_loadu_ps(row + w * 64 + 8 * k), vt, _CMP_LT_OQ);
+            word |= (uint64_t) _mm256_movemask_ps(lt) << (8 * k);
+        }
+        out[w] = word;
+    }
+    mask_tail(row, out, w, n, threshold);
+}
+
+__attribute__((target("avx512f")))
+static void mask_row_avx512(const float *row, uint64_t *out, long n, float threshold) {
+    __m512 vt = _mm512_set1_ps(threshold);
+    long w = 0;
+    for (; (w + 1) * 64 <= n; w++) {
+        uint64_t word = 0;
+        for (int k = 0; k < 4; k++) {
+            __mmask16 lt = _mm512_cmp_ps_mask(_mm512_loadu_ps(row + w * 64 + 16 * k), vt, _CMP_LT_OQ);
+            word |= (uint64_t) lt << (16 * k);
+        }
+        out[w] = word;
+    }
+    mask_tail(row, out, w, n, threshold);
+}
+
+static int has_any(void)    { return 1; }
+static int has_avx2(void)   { return __builtin_cpu_supports("avx2"); }
+static int has_avx512(void) { return __builtin_cpu_supports("avx512f"); }
+
+// Best first; "auto" takes the first entry whose ISA the CPU reports
+static const struct {
+    const char *name;
+    mask_row_fn row;
+    int (*supported)(void);
+} mask_kernels[] = {
+    { "avx512", mask_row_avx512, has_avx512 },
+    { "avx2",   mask_row_avx2,   has_avx2 },
+    { "scalar", mask_row_scalar, has_any },
+};
+
+long mask_words(long array_size) {
+    return (array_size + 63) / 64;
+}
+
+const char *mask_kernel_select(const char *name, int *which) {
+    int n = sizeof(mask_kernels) / sizeof(mask_kernels[0]);
+
+    __builtin_cpu_init();
+    for (int k = 0; k < n; k++) {
+        if ((name == NULL || strcmp(name, "auto") == 0 || strcmp(name, mask_kernels[k].name) == 0) &&
+            mask_kernels[k].supported()) {
+            *which = k;
+            return mask_kernels[k].name;
+        }
+    }
+    return NULL;
+}
+
+long mask_build(uint64_t *mask, const float *array, long array_size, float threshold, const char *kernel) {
+    long words = mask_words(array_size);
+    long total = 0;
+    int which;
+
+    if (mask_kernel_select(kernel, &which) == NULL) {
+        return -1;
+    }
+    mask_row_fn row_fn = mask_kernels[which].row;
+
+    #pragma omp parallel for reduction(+:total) schedule(static)
+        for (long j = 0; j < array_size; j++) {
+            uint64_t *out = mask + j * words;
+
+            if (j == 0 || j == array_size - 1) {
+                memset(out, 0, words * sizeof(uint64_t));
+                continue;
+            }
+            row_fn(array + j * array_size, out, array_size, threshold);
+
+            // Border columns never count
+            out[0] &= ~1ULL;
+            out[(array_size - 1) >> 6] &= ~(1ULL << ((array_size - 1) & 63));
+            for (long w = 0; w < words; w++) {
+                total += __builtin_popcountll(out[w]);
+            }
+        }
+    return total;
+}
+
+long mask_popcount(const uint64_t *mask, long array_size) {
+    long nwords = mask_words(array_size) * array_size;
+    long total = 0;
+
+    #pragma omp parallel for reduction(+:total) schedule(static)
+        for (long w = 0; w < nwords; w++) {
+            total += __builtin_popcountll(mask[w]);
+        }
+    return total;
+}
+
+// dst = p op q word by word; returns the popcount of dst.  dst may alias p or q.
+long mask_combine(uint64_t *dst, const uint64_t *p, const uint64_t *q, long array_size, int op) {
+    long nwords = mask_words(array_size) * array_size;
+    long total = 0;
+
+    #pragma omp parallel for reduction(+:total) schedule(static)
+        for (long w = 0; w < nwords; w++) {
+            uint64_t v = op == MASK_AND ? p[w] & q[w] :
+                         op == MASK_OR  ? p[w] | q[w] :
+                                          p[w] & ~q[w];
+            dst[w] = v;
+            total += __builtin_popcountll(v);
+        }
+    return total;
+}
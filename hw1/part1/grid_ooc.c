@@ -0,0 +1,177 @@
+// Out-of-core smoothing over memory-mapped grid files
+//
+// x and y live in flat row-major float files.  The grid is processed in
+// bands of band_rows rows: the x window of a band covers its rows plus one
+// row above and below (consecutive windows overlap by the three rows the
+// stencil straddles), the y window covers just the band.  While band k is
+// smoothed and counted, the x window of band k+1 is already mapped and
+// madvise(MADV_WILLNEED)-ed so the kernel reads it ahead.  Finished windows
+// are unmapped and dropped from the page cache, so resident memory stays
+// near three bands regardless of the grid size.
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <omp.h>
+
+#include "grid.h"
+
+typedef struct {
+    char *map;       // page-aligned mapping
+    size_t len;
+    off_t offset;
+    float *rows;     // first requested row inside the mapping
+} window_t;
+
+static int map_rows(window_t *w, int fd, long first_row, long nrows, long array_size, int prot) {
+    size_t page = getpagesize();
+    off_t start = (off_t) first_row * array_size * sizeof(float);
+    off_t aligned = start / page * page;
+    size_t len = (size_t) (start - aligned) + (size_t) nrows * array_size * sizeof(float);
+
+    w->map = (char *) mmap(NULL, len, prot, MAP_SHARED, fd, aligned);
+    if (w->map == MAP_FAILED) {
+        w->map = NULL;
+        return -1;
+    }
+    w->len = len;
+    w->offset = aligned;
+    w->rows = (float *) (w->map + (start - aligned));
+    return 0;
+}
+
+static void unmap_rows(window_t *w, int fd, int dirty) {
+    if (w->map == NULL) {
+        return;
+    }
+    if (dirty) {
+        // Push the band to disk so its page-cache copy can be dropped
+        msync(w->map, w->len, MS_SYNC);
+    }
+    munmap(w->map, w->len);
+    posix_fadvise(fd, w->offset, w->len, POSIX_FADV_DONTNEED);
+    w->map = NULL;
+}
+
+static int write_row(int fd, long row, const float *src, long array_size) {
+    size_t len = array_size * sizeof(float);
+    return pwrite(fd, src, len, (off_t) row * len) == (ssize_t) len ? 0 : -1;
+}
+
+long ooc_band_rows(long array_size, long band_bytes) {
+    long rows = band_bytes / (array_size * (long) sizeof(float));
+    return rows > 0 ? rows : 1;
+}
+
+int ooc_initialize(const char *path, long array_size, long band_rows) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    float *band = (float *) malloc(band_rows * array_size * sizeof(float));
+    int status = band == NULL ? -1 : 0;
+
+    for (long j0 = 0; status == 0 && j0 < array_size; j0 += band_rows) {
+        long nrows = j0 + band_rows < array_size ? band_rows : array_size - j0;
+
+        #pragma omp parallel for schedule(static)
+            for (long j = j0; j < j0 + nrows; j++) {
+                for (long i = 0; i < array_size; i++) {
+                    band[i + (j - j0) * array_size] = grid_value(i, j);
+                }
+            }
+
+        size_t len = nrows * array_size * sizeof(float);
+        off_t offset = (off_t) j0 * array_size * sizeof(float);
+        if (pwrite(fd, band, len, offset) != (ssize_t) len) {
+            status = -1;
+        }
+        posix_fadvise(fd, offset, len, POSIX_FADV_DONTNEED);
+    }
+
+    free(band);
+    close(fd);
+    return status;
+}
+
+int ooc_smooth_count(const char *x_path, const char *y_path, long array_size, long band_rows,
+                     float a, float b, float c, float threshold,
+                     long *x_below_threshold, long *y_below_threshold) {
+    int xfd = open(x_path, O_RDONLY);
+    int yfd = open(y_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    int status = 0;
+    long x_total = 0, y_total = 0;
+
+    if (xfd < 0 || yfd < 0 || ftruncate(yfd, (off_t) array_size * array_size * sizeof(float)) != 0) {
+        if (xfd >= 0) close(xfd);
+        if (yfd >= 0) close(yfd);
+        return -1;
+    }
+
+    // Border cells of y are copies of x, as in copy_border()
+    window_t cur = { 0 }, next = { 0 }, out = { 0 };
+
+    for (long j0 = 1; status == 0 && j0 < array_size - 1; j0 += band_rows) {
+        long nrows = j0 + band_rows <= array_size - 1 ? band_rows : array_size - 1 - j0;
+
+        if (j0 == 1) {
+            status |= map_rows(&cur, xfd, j0 - 1, nrows + 2, array_size, PROT_READ);
+        } else {
+            cur = next;
+            next.map = NULL;
+        }
+
+        // Prefetch the next band's window while this one is computed
+        long nj0 = j0 + band_rows;
+        if (status == 0 && nj0 < array_size - 1) {
+            long nn = nj0 + band_rows <= array_size - 1 ? band_rows : array_size - 1 - nj0;
+            status |= map_rows(&next, xfd, nj0 - 1, nn + 2, array_size, PROT_READ);
+            if (status == 0) {
+                madvise(next.map, next.len, MADV_WILLNEED);
+            }
+        }
+
+        status |= map_rows(&out, yfd, j0, nrows, array_size, PROT_READ | PROT_WRITE);
+        if (status != 0) {
+            break;
+        }
+
+        #pragma omp parallel for reduction(+:x_total, y_total) schedule(static)
+            for (long j = 0; j < nrows; j++) {
+                const float *row = cur.rows + (j + 1) * array_size;
+                float *out_row = out.rows + j * array_size;
+                out_row[0] = row[0];
+                out_row[array_size - 1] = row[array_size - 1];
+                for (long i = 1; i < array_size - 1; i++) {
+                    float value = stencil9(row + i, array_size, a, b, c);
+                    out_row[i] = value;
+                    x_total += row[i] < threshold;
+                    y_total += value < threshold;
+                }
+            }
+
+        // First/last band also copies the top/bottom border row of x
+        if (j0 == 1) {
+            status |= write_row(yfd, 0, cur.rows, array_size);
+        }
+        if (j0 + nrows == array_size - 1) {
+            status |= write_row(yfd, array_size - 1, cur.rows + (nrows + 1) * array_size, array_size);
+        }
+
+        unmap_rows(&out, yfd, 1);
+        unmap_rows(&cur, xfd, 0);
+    }
+
+    unmap_rows(&cur, xfd, 0);
+    unmap_rows(&next, xfd, 0);
+    close(xfd);
+    close(yfd);
+
+    *x_below_threshold = x_total;
+    *y_below_threshold = y_total;
+    return status;
+}
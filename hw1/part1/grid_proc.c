@@ -0,0 +1,113 @@
+// Procedural (periodic) input grids
+//
+// grid_value(i, j) only depends on i mod 11, i mod 7, j mod 5 and j mod 3,
+// so x repeats every 77 columns and 15 rows.  Once the period is known:
+//   - count(x) has a closed form: the below-threshold cells of one period
+//     tile, weighted by how many times each residue occurs in the inner
+//     range (full periods plus the partial one at the edge);
+//   - x never needs to be stored: the smoother reads the pj distinct rows
+//     of x from a small table instead of a full grid.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+// Smallest p <= max_period with gen shifted by p along one axis equal to
+// gen over a 2 * max_period square window; 0 when none is found
+static int detect_axis(float (*gen)(int, int), int max_period, int along_i) {
+    int window = 2 * max_period;
+
+    for (int p = 1; p <= max_period; p++) {
+        int periodic = 1;
+        for (int j = 0; j < window && periodic; j++) {
+            for (int i = 0; i < window && periodic; i++) {
+                float v = gen(i, j);
+                float w = along_i ? gen(i + p, j) : gen(i, j + p);
+                periodic = v == w;
+            }
+        }
+        if (periodic) {
+            return p;
+        }
+    }
+    return 0;
+}
+
+int proc_detect_period(float (*gen)(int, int), int max_period, proc_grid_t *pg) {
+    pg->pi = detect_axis(gen, max_period, 1);
+    pg->pj = detect_axis(gen, max_period, 0);
+    pg->gen = gen;
+    return pg->pi > 0 && pg->pj > 0 ? 0 : -1;
+}
+
+// Number of k in [lo, hi] with k % p == r
+static long residue_count(long lo, long hi, int p, int r) {
+    if (hi < lo) {
+        return 0;
+    }
+    long len = hi - lo + 1;
+    long full = len / p;
+    long rem = len % p;
+    long offset = ((r - lo % p) % p + p) % p;
+    return full + (offset < rem);
+}
+
+long proc_count(const proc_grid_t *pg, long array_size, float threshold) {
+    long total = 0;
+
+    for (int rj = 0; rj < pg->pj; rj++) {
+        long nj = residue_count(1, array_size - 2, pg->pj, rj);
+        for (int ri = 0; ri < pg->pi; ri++) {
+            if (pg->gen(ri, rj) < threshold) {
+                total += nj * residue_count(1, array_size - 2, pg->pi, ri);
+            }
+        }
+    }
+    return total;
+}
+
+// Smooth the procedural x into y (border included) and count y below
+// threshold; -1, with y untouched, if the row table cannot be allocated
+int proc_smooth_count(const proc_grid_t *pg, float *out_array, long array_size,
+                       float a, float b, float c, float threshold, long *y_below_threshold) {
+    // The pj distinct rows of x, full width so the inner loop has no modulo
+    float *rows = (float *) malloc((size_t) pg->pj * array_size * sizeof(float));
+    long y_total = 0;
+
+    if (rows == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel for schedule(static)
+        for (long k = 0; k < pg->pj * array_size; k++) {
+            rows[k] = pg->gen(k % array_size, k / array_size);
+        }
+
+    memcpy(out_array, rows, array_size * sizeof(float));
+    memcpy(out_array + (array_size - 1) * array_size,
+           rows + ((array_size - 1) % pg->pj) * array_size, array_size * sizeof(float));
+
+    #pragma omp parallel for reduction(+:y_total) schedule(static)
+        for (long j = 1; j < array_size - 1; j++) {
+            const float *up = rows + ((j - 1) % pg->pj) * array_size;
+            const float *mid = rows + (j % pg->pj) * array_size;
+            const float *down = rows + ((j + 1) % pg->pj) * array_size;
+            float *out = out_array + j * array_size;
+
+            out[0] = mid[0];
+            out[array_size - 1] = mid[array_size - 1];
+            for (long i = 1; i < array_size - 1; i++) {
+                float value = a * (up[i - 1] + down[i - 1] + up[i + 1] + down[i + 1]) +
+                              b * (mid[i - 1] + mid[i + 1] + up[i] + down[i]) +
+                              c * mid[i];
+                out[i] = value;
+                y_total += value < threshold;
+            }
+        }
+
+    free(rows);
+    *y_below_threshold = y_total;
+    return 0;
+}
@@ -0,0 +1,195 @@
+// Summed-area tables of the below-threshold indicator, for rectangle counts
+//
+// Full table: sat[(j + 1) * (n + 1) + (i + 1)] is the number of inner cells
+// below the threshold in columns [0, i] and rows [0, j]; row 0 and column 0
+// are zero so a query is four loads.  Entries are uint32_t and wrap modulo
+// 2^32, which leaves the four-term difference exact for any rectangle
+// holding fewer than 2^32 cells (4 bytes per cell).
+//
+// Block table: the 1-bit threshold mask of grid_mask.c plus a 64-bit
+// summed-area table over B x B blocks (1/8 + 8/B^2 bytes per cell, no size
+// limit).  Whole blocks inside a query come from the block table, the ragged
+// edges from popcounts over the mask rows, so a query costs
+// O(B * width / 64 + height) instead of O(width * height).
+//
+// Both builds are parallel.  The full table uses the blocked two-pass
+// prefix sum: each thread builds the table of its own band of rows, the
+// band totals are scanned across bands (in parallel over columns), and each
+// thread adds the totals of the bands above it to its rows.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+static inline int below(const float *array, long n, long i, long j, float threshold) {
+    return i > 0 && j > 0 && i < n - 1 && j < n - 1 && array[i + j * n] < threshold;
+}
+
+// Returns -1, leaving sat untouched, if the band carries cannot be allocated
+int sat_build(uint32_t *sat, const float *array, long array_size, float threshold) {
+    long n = array_size, stride = n + 1;
+    int nthreads = omp_get_max_threads();
+    uint32_t *carry = (uint32_t *) calloc((size_t) nthreads * stride, sizeof(uint32_t));
+
+    if (carry == NULL) {
+        return -1;
+    }
+    memset(sat, 0, stride * sizeof(uint32_t));
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        long r0 = 1 + n * t / nt;
+        long r1 = 1 + n * (t + 1) / nt;
+
+        // Pass 1: table of this band alone
+        for (long r = r0; r < r1; r++) {
+            uint32_t *row = sat + r * stride;
+            const uint32_t *prev = sat + (r - 1) * stride;
+            uint32_t s = 0;
+            row[0] = 0;
+            for (long i = 1; i <= n; i++) {
+                s += below(array, n, i - 1, r - 1, threshold);
+                row[i] = r > r0 ? s + prev[i] : s;
+            }
+        }
+        #pragma omp barrier
+
+        // Scan band totals: carry[t] = sum of the last rows of bands 0..t-1
+        #pragma omp for schedule(static)
+            for (long i = 0; i <= n; i++) {
+                uint32_t s = 0;
+                for (int k = 0; k < nt; k++) {
+                    long last = 1 + n * (k + 1) / nt - 1;
+                    carry[k * stride + i] = s;
+                    if (last >= 1 + n * k / nt) {
+                        s += sat[last * stride + i];
+                    }
+                }
+            }
+
+        // Pass 2: shift each band by the bands above it
+        if (t > 0) {
+            const uint32_t *add = carry + t * stride;
+            for (long r = r0; r < r1; r++) {
+                uint32_t *row = sat + r * stride;
+                for (long i = 0; i <= n; i++) {
+                    row[i] += add[i];
+                }
+            }
+        }
+    }
+
+    free(carry);
+    return 0;
+}
+
+// Cells below threshold in columns [i0, i1), rows [j0, j1)
+long sat_query(const uint32_t *sat, long array_size, long i0, long j0, long i1, long j1) {
+    long stride = array_size + 1;
+    uint32_t v = sat[j1 * stride + i1] - sat[j0 * stride + i1] - sat[j1 * stride + i0] + sat[j0 * stride + i0];
+    return v;
+}
+
+// Set bits of one bitmap row in [i0, i1)
+static long popcount_range(const uint64_t *row, long i0, long i1) {
+    if (i0 >= i1) {
+        return 0;
+    }
+    long w0 = i0 >> 6, w1 = (i1 - 1) >> 6;
+    uint64_t first = ~0ULL << (i0 & 63);
+    uint64_t last = ~0ULL >> (63 - ((i1 - 1) & 63));
+    if (w0 == w1) {
+        return __builtin_popcountll(row[w0] & first & last);
+    }
+    long total = __builtin_popcountll(row[w0] & first) + __builtin_popcountll(row[w1] & last);
+    for (long w = w0 + 1; w < w1; w++) {
+        total += __builtin_popcountll(row[w]);
+    }
+    return total;
+}
+
+sat_block_t *sat_block_build(const float *array, long array_size, float threshold, int block) {
+    sat_block_t *s = (sat_block_t *) calloc(1, sizeof(sat_block_t));
+    long n = array_size;
+
+    if (s == NULL) {
+        return NULL;
+    }
+    s->n = n;
+    s->block = block;
+    s->nblocks = (n + block - 1) / block;
+    s->words = mask_words(n);
+    s->bits = (uint64_t *) calloc((size_t) s->words * n, sizeof(uint64_t));
+    s->bsat = (uint64_t *) calloc((size_t) (s->nblocks + 1) * (s->nblocks + 1), sizeof(uint64_t));
+    if (s->bits == NULL || s->bsat == NULL) {
+        sat_block_free(s);
+        return NULL;
+    }
+
+    mask_build(s->bits, array, n, threshold, NULL);
+
+    // Block counts, stored one row/column in so the prefix sums can run in place
+    long bstride = s->nblocks + 1;
+    #pragma omp parallel for schedule(static)
+        for (long bj = 0; bj < s->nblocks; bj++) {
+            for (long bi = 0; bi < s->nblocks; bi++) {
+                long total = 0;
+                for (long j = bj * block; j < (bj + 1) * block && j < n; j++) {
+                    total += popcount_range(s->bits + j * s->words, bi * block,
+                                            (bi + 1) * block < n ? (bi + 1) * block : n);
+                }
+                s->bsat[(bj + 1) * bstride + bi + 1] = total;
+            }
+        }
+
+    // The block table is small: plain serial prefix sums
+    for (long bj = 1; bj <= s->nblocks; bj++) {
+        uint64_t *row = s->bsat + bj * bstride;
+        const uint64_t *prev = row - bstride;
+        uint64_t acc = 0;
+        for (long bi = 1; bi <= s->nblocks; bi++) {
+            acc += row[bi];
+            row[bi] = acc + prev[bi];
+        }
+    }
+    return s;
+}
+
+void sat_block_free(sat_block_t *s) {
+    free(s->bits);
+    free(s->bsat);
+    free(s);
+}
+
+static long rows_popcount(const sat_block_t *s, long i0, long i1, long j0, long j1) {
+    long total = 0;
+    for (long j = j0; j < j1; j++) {
+        total += popcount_range(s->bits + j * s->words, i0, i1);
+    }
+    return total;
+}
+
+long sat_block_query(const sat_block_t *s, long i0, long j0, long i1, long j1) {
+    long B = s->block;
+    long bi0 = (i0 + B - 1) / B, bi1 = i1 / B;
+    long bj0 = (j0 + B - 1) / B, bj1 = j1 / B;
+
+    if (bi0 >= bi1 || bj0 >= bj1) {
+        return rows_popcount(s, i0, i1, j0, j1);
+    }
+
+    // Whole blocks [bi0, bi1) x [bj0, bj1), then the four edge strips
+    long bstride = s->nblocks + 1;
+    const uint64_t *t = s->bsat;
+    long total = t[bj1 * bstride + bi1] - t[bj0 * bstride + bi1] - t[bj1 * bstride + bi0] + t[bj0 * bstride + bi0];
+
+    total += rows_popcount(s, i0, i1, j0, bj0 * B);
+    total += rows_popcount(s, i0, i1, bj1 * B, j1);
+    total += rows_popcount(s, i0, bi0 * B, bj0 * B, bj1 * B);
+    total += rows_popcount(s, bi1 * B, i1, bj0 * B, bj1 * B);
+    return total;
+}
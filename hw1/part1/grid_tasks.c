@@ -0,0 +1,210 @@
+// Task-graph version of init -> smooth -> count
+//
+// The grid is cut into tile_rows x tile_cols tiles and every phase of every
+// tile is an OpenMP task.  Dependencies are declared per tile on small
+// sentinel arrays instead of with barriers between phases:
+//   init(t)     writes x on tile t                      out: xd[t]
+//   count_x(t)  counts x on tile t                      in:  xd[t]
+//   smooth(t)   writes y on tile t from x on t + halo   in:  xd[t and its 8 neighbours]
+//                                                       out: yd[t]
+//   count_y(t)  counts y on tile t                      in:  yd[t]
+// so a tile is smoothed as soon as its neighbourhood is initialised, and
+// counted while it is still in cache.  Tasks are generated one tile row at
+// a time, lagging smooth by a row, so the runtime sees ready work early.
+// Per-tile counts are summed at the end, which keeps the totals
+// deterministic.  With a trace the start/stop time of every task is kept
+// to report how much the phases overlap.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+typedef struct {
+    float *x, *y;
+    long n;
+    long tr, tc;                // tile size
+    long nty, ntx;              // tiles per column / row
+    float a, b, c, threshold;
+    long *x_count, *y_count;
+    task_trace_t *trace;
+} task_grid_t;
+
+static void tile_bounds(const task_grid_t *g, long t, long *i0, long *i1, long *j0, long *j1) {
+    long ti = t % g->ntx, tj = t / g->ntx;
+    *i0 = ti * g->tc;
+    *j0 = tj * g->tr;
+    *i1 = *i0 + g->tc < g->n ? *i0 + g->tc : g->n;
+    *j1 = *j0 + g->tr < g->n ? *j0 + g->tr : g->n;
+}
+
+static void trace_mark(task_grid_t *g, int phase, long t, double start) {
+    if (g->trace != NULL) {
+        task_span_t *s = &g->trace->spans[phase * g->nty * g->ntx + t];
+        s->start = start;
+        s->stop = omp_get_wtime();
+    }
+}
+
+static void init_tile(task_grid_t *g, long t) {
+    double start = omp_get_wtime();
+    long i0, i1, j0, j1;
+    tile_bounds(g, t, &i0, &i1, &j0, &j1);
+
+    for (long j = j0; j < j1; j++) {
+        for (long i = i0; i < i1; i++) {
+            g->x[i + j * g->n] = grid_value(i, j);
+        }
+    }
+    trace_mark(g, TASK_INIT, t, start);
+}
+
+static long count_tile(const task_grid_t *g, const float *array, long t) {
+    long i0, i1, j0, j1, total = 0;
+    tile_bounds(g, t, &i0, &i1, &j0, &j1);
+
+    // Inner cells only, as in count()
+    for (long j = j0 > 1 ? j0 : 1; j < j1 && j < g->n - 1; j++) {
+        for (long i = i0 > 1 ? i0 : 1; i < i1 && i < g->n - 1; i++) {
+            total += array[i + j * g->n] < g->threshold;
+        }
+    }
+    return total;
+}
+
+static void smooth_tile(task_grid_t *g, long t) {
+    double start = omp_get_wtime();
+    long n = g->n, i0, i1, j0, j1;
+    tile_bounds(g, t, &i0, &i1, &j0, &j1);
+
+    for (long j = j0; j < j1; j++) {
+        const float *row = g->x + j * n;
+        float *out_row = g->y + j * n;
+
+        // The outer ring of y is a copy of x, as in copy_border()
+        if (j == 0 || j == n - 1) {
+            memcpy(out_row + i0, row + i0, (i1 - i0) * sizeof(float));
+            continue;
+        }
+        if (i0 == 0) {
+            out_row[0] = row[0];
+        }
+        if (i1 == n) {
+            out_row[n - 1] = row[n - 1];
+        }
+        for (long i = i0 > 1 ? i0 : 1; i < i1 && i < n - 1; i++) {
+            out_row[i] = stencil9(row + i, n, g->a, g->b, g->c);
+        }
+    }
+    trace_mark(g, TASK_SMOOTH, t, start);
+}
+
+// Returns -1, before any task is created, if the per-tile bookkeeping
+// cannot be allocated
+int task_smooth_count(float *array, float *out_array, long array_size, long tile_rows, long tile_cols,
+                       float a, float b, float c, float threshold,
+                       long *x_below_threshold, long *y_below_threshold, task_trace_t *trace) {
+    task_grid_t g = { array, out_array, array_size, tile_rows, tile_cols,
+                      (array_size + tile_rows - 1) / tile_rows, (array_size + tile_cols - 1) / tile_cols,
+                      a, b, c, threshold, NULL, NULL, trace };
+    long ntiles = g.nty * g.ntx;
+
+    // Sentinels: only their addresses matter to depend()
+    char *xd = (char *) calloc(ntiles, 1);
+    char *yd = (char *) calloc(ntiles, 1);
+    g.x_count = (long *) calloc(ntiles, sizeof(long));
+    g.y_count = (long *) calloc(ntiles, sizeof(long));
+    if (trace != NULL) {
+        trace->ntiles = ntiles;
+        trace->spans = (task_span_t *) calloc(TASK_NPHASES * ntiles, sizeof(task_span_t));
+    }
+    if (xd == NULL || yd == NULL || g.x_count == NULL || g.y_count == NULL ||
+        (trace != NULL && trace->spans == NULL)) {
+        free(xd);
+        free(yd);
+        free(g.x_count);
+        free(g.y_count);
+        if (trace != NULL) {
+            free(trace->spans);
+            trace->spans = NULL;
+        }
+        return -1;
+    }
+    if (trace != NULL) {
+        trace->origin = omp_get_wtime();
+    }
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for (long tj = 0; tj <= g.nty; tj++) {
+            // Tile row tj: init and count x
+            for (long ti = 0; tj < g.nty && ti < g.ntx; ti++) {
+                long t = ti + tj * g.ntx;
+
+                #pragma omp task firstprivate(t) depend(out: xd[t])
+                init_tile(&g, t);
+
+                #pragma omp task firstprivate(t) depend(in: xd[t])
+                {
+                    double start = omp_get_wtime();
+                    g.x_count[t] = count_tile(&g, g.x, t);
+                    trace_mark(&g, TASK_COUNT_X, t, start);
+                }
+            }
+
+            // Tile row tj - 1: its lower neighbours now have tasks
+            for (long ti = 0; tj > 0 && ti < g.ntx; ti++) {
+                long sj = tj - 1;
+                long t = ti + sj * g.ntx;
+                long up = (sj > 0 ? sj - 1 : sj) * g.ntx, mid = sj * g.ntx;
+                long down = (sj + 1 < g.nty ? sj + 1 : sj) * g.ntx;
+                long l = ti > 0 ? ti - 1 : ti, r = ti + 1 < g.ntx ? ti + 1 : ti;
+
+                #pragma omp task firstprivate(t) \
+                    depend(in: xd[up + l], xd[up + ti], xd[up + r], \
+                               xd[mid + l], xd[mid + ti], xd[mid + r], \
+                               xd[down + l], xd[down + ti], xd[down + r]) \
+                    depend(out: yd[t])
+                smooth_tile(&g, t);
+
+                #pragma omp task firstprivate(t) depend(in: yd[t])
+                {
+                    double start = omp_get_wtime();
+                    g.y_count[t] = count_tile(&g, g.y, t);
+                    trace_mark(&g, TASK_COUNT_Y, t, start);
+                }
+            }
+        }
+    }
+
+    long x_total = 0, y_total = 0;
+    for (long t = 0; t < ntiles; t++) {
+        x_total += g.x_count[t];
+        y_total += g.y_count[t];
+    }
+    *x_below_threshold = x_total;
+    *y_below_threshold = y_total;
+
+    free(xd);
+    free(yd);
+    free(g.x_count);
+    free(g.y_count);
+    return 0;
+}
+
+// Span [first start, last stop] and summed busy time of one phase, relative to the trace origin
+void task_trace_phase(const task_trace_t *trace, int phase, double *first, double *last, double *busy) {
+    const task_span_t *s = trace->spans + phase * trace->ntiles;
+    *first = 1.0e30;
+    *last = 0;
+    *busy = 0;
+    for (long t = 0; t < trace->ntiles; t++) {
+        *first = s[t].start < *first ? s[t].start : *first;
+        *last = s[t].stop > *last ? s[t].stop : *last;
+        *busy += s[t].stop - s[t].start;
+    }
+    *first -= trace->origin;
+    *last -= trace->origin;
+}
@@ -0,0 +1,188 @@
+// Tiled grid with dirty-tile tracking and incrementally maintained counts
+//
+// x and y stay ordinary row-major arrays; the tiling is bookkeeping on top:
+//   - per tile, the number of inner x and y cells below the threshold;
+//   - per tile, an x-dirty flag (its x cells changed) and a y-dirty flag (a
+//     changed x cell is inside the tile or on its one-cell halo).
+// tile_grid_write() only copies the new values in, sets the flags and
+// appends newly dirty tiles to a list (the flag keeps a tile from being
+// listed twice).  tile_grid_refresh() then walks the lists: it recounts x
+// on x-dirty tiles, re-smooths and recounts y on y-dirty tiles, and adjusts
+// the totals by the difference between each tile's old and new counts, so
+// the cost is proportional to the area that changed, not to the tile count.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+// Mark tiles overlapping the cell rectangle [i0, i1) x [j0, j1), clipped to
+// the grid, and list the ones that were clean
+static void mark(tile_grid_t *g, unsigned char *flags, long *list, long *nlist,
+                 long i0, long j0, long i1, long j1) {
+    i0 = i0 < 0 ? 0 : i0;
+    j0 = j0 < 0 ? 0 : j0;
+    i1 = i1 > g->n ? g->n : i1;
+    j1 = j1 > g->n ? g->n : j1;
+    if (i0 >= i1 || j0 >= j1) {
+        return;
+    }
+    for (long tj = j0 / g->tile; tj <= (j1 - 1) / g->tile; tj++) {
+        for (long ti = i0 / g->tile; ti <= (i1 - 1) / g->tile; ti++) {
+            long t = ti + tj * g->ntiles;
+            if (!flags[t]) {
+                flags[t] = 1;
+                list[(*nlist)++] = t;
+            }
+        }
+    }
+}
+
+// Inner-cell range [lo, hi) of tile t along one axis
+static void tile_range(const tile_grid_t *g, long t, long *lo, long *hi) {
+    *lo = t * g->tile < 1 ? 1 : t * g->tile;
+    *hi = (t + 1) * g->tile > g->n - 1 ? g->n - 1 : (t + 1) * g->tile;
+}
+
+static long count_tile(const tile_grid_t *g, const float *array, long t) {
+    long i0, i1, j0, j1, total = 0;
+    tile_range(g, t % g->ntiles, &i0, &i1);
+    tile_range(g, t / g->ntiles, &j0, &j1);
+
+    for (long j = j0; j < j1; j++) {
+        for (long i = i0; i < i1; i++) {
+            total += array[i + j * g->n] < g->threshold;
+        }
+    }
+    return total;
+}
+
+static long smooth_count_tile(tile_grid_t *g, long t) {
+    long i0, i1, j0, j1, total = 0;
+    tile_range(g, t % g->ntiles, &i0, &i1);
+    tile_range(g, t / g->ntiles, &j0, &j1);
+
+    for (long j = j0; j < j1; j++) {
+        const float *row = g->x + j * g->n;
+        float *out_row = g->y + j * g->n;
+        for (long i = i0; i < i1; i++) {
+            float value = stencil9(row + i, g->n, g->a, g->b, g->c);
+            out_row[i] = value;
+            total += value < g->threshold;
+        }
+    }
+    return total;
+}
+
+tile_grid_t *tile_grid_create(long array_size, int tile, float a, float b, float c, float threshold) {
+    tile_grid_t *g = (tile_grid_t *) calloc(1, sizeof(tile_grid_t));
+    long ntiles;
+
+    if (g == NULL) {
+        return NULL;
+    }
+    g->n = array_size;
+    g->tile = tile;
+    g->ntiles = (array_size + tile - 1) / tile;
+    g->a = a;
+    g->b = b;
+    g->c = c;
+    g->threshold = threshold;
+    ntiles = g->ntiles * g->ntiles;
+
+    g->x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    g->y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    g->x_count = (long *) calloc(ntiles, sizeof(long));
+    g->y_count = (long *) calloc(ntiles, sizeof(long));
+    g->x_dirty = (unsigned char *) calloc(ntiles, 1);
+    g->y_dirty = (unsigned char *) calloc(ntiles, 1);
+    g->x_list = (long *) malloc(ntiles * sizeof(long));
+    g->y_list = (long *) malloc(ntiles * sizeof(long));
+    if (g->x == NULL || g->y == NULL || g->x_count == NULL || g->y_count == NULL ||
+        g->x_dirty == NULL || g->y_dirty == NULL || g->x_list == NULL || g->y_list == NULL) {
+        tile_grid_free(g);
+        return NULL;
+    }
+
+    // Full build: everything is dirty once
+    initialize(g->x, array_size);
+    copy_border(g->x, g->y, array_size);
+    mark(g, g->x_dirty, g->x_list, &g->nx_dirty, 0, 0, array_size, array_size);
+    mark(g, g->y_dirty, g->y_list, &g->ny_dirty, 0, 0, array_size, array_size);
+    tile_grid_refresh(g);
+    return g;
+}
+
+void tile_grid_free(tile_grid_t *g) {
+    grid_free(g->x);
+    grid_free(g->y);
+    free(g->x_count);
+    free(g->y_count);
+    free(g->x_dirty);
+    free(g->y_dirty);
+    free(g->x_list);
+    free(g->y_list);
+    free(g);
+}
+
+// Overwrite the w x h rectangle of x at column i0, row j0 with src (row
+// stride src_stride) and mark the tiles it affects.  Returns -1, writing
+// nothing, if the rectangle is empty or does not lie inside the grid.
+int tile_grid_write(tile_grid_t *g, long i0, long j0, long w, long h, const float *src, long src_stride) {
+    long n = g->n;
+
+    if (i0 < 0 || j0 < 0 || w <= 0 || h <= 0 || w > n - i0 || h > n - j0) {
+        return -1;
+    }
+
+    for (long j = 0; j < h; j++) {
+        memcpy(g->x + i0 + (j0 + j) * n, src + j * src_stride, w * sizeof(float));
+    }
+
+    // y's border is a copy of x's, as in copy_border()
+    for (long j = j0; j < j0 + h; j++) {
+        for (long i = i0; i < i0 + w; i++) {
+            if (i == 0 || j == 0 || i == n - 1 || j == n - 1) {
+                g->y[i + j * n] = g->x[i + j * n];
+            }
+        }
+    }
+
+    mark(g, g->x_dirty, g->x_list, &g->nx_dirty, i0, j0, i0 + w, j0 + h);
+    mark(g, g->y_dirty, g->y_list, &g->ny_dirty, i0 - 1, j0 - 1, i0 + w + 1, j0 + h + 1);
+    return 0;
+}
+
+// Recompute dirty tiles and fold their count changes into the totals;
+// returns the number of tiles re-smoothed
+long tile_grid_refresh(tile_grid_t *g) {
+    long nx = g->nx_dirty, ny = g->ny_dirty;
+    long x_delta = 0, y_delta = 0;
+
+    // x: recount
+    #pragma omp parallel for reduction(+:x_delta) schedule(dynamic)
+        for (long k = 0; k < nx; k++) {
+            long t = g->x_list[k];
+            long fresh = count_tile(g, g->x, t);
+            x_delta += fresh - g->x_count[t];
+            g->x_count[t] = fresh;
+            g->x_dirty[t] = 0;
+        }
+
+    // y: re-smooth and recount
+    #pragma omp parallel for reduction(+:y_delta) schedule(dynamic)
+        for (long k = 0; k < ny; k++) {
+            long t = g->y_list[k];
+            long fresh = smooth_count_tile(g, t);
+            y_delta += fresh - g->y_count[t];
+            g->y_count[t] = fresh;
+            g->y_dirty[t] = 0;
+        }
+
+    g->nx_dirty = g->ny_dirty = 0;
+    g->x_below += x_delta;
+    g->y_below += y_delta;
+    return ny;
+}
@@ -0,0 +1,117 @@
+// Client for the resident grid service (gridd.c)
+//
+// usage: a.out_gridc [--socket=PATH] [--repeat=R] "request" ["request" ...]
+// e.g.   a.out_gridc "smooth 0.05 0.1 0.4 0.1" "smooth 0.05 0.1 0.4 0.2,0.5" info
+//
+// All requests (each repeated R times) are written as fast as the socket
+// takes them, so the daemon sees them queued together and can batch them.
+// Replies are read while the requests are still being written: a burst
+// larger than the socket buffers would otherwise leave both sides blocked
+// on a full buffer.  Prints one reply line per request and the round-trip
+// time.
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "grid.h"
+
+int main(int argc, char *argv[]) {
+
+    const char *socket_path = "/tmp/gridd.sock";
+    int repeat = 1;
+    int first = 1;
+
+    for (; first < argc && strncmp(argv[first], "--", 2) == 0; first++) {
+        if (strncmp(argv[first], "--socket=", 9) == 0) {
+            socket_path = argv[first] + 9;
+        } else if (strncmp(argv[first], "--repeat=", 9) == 0) {
+            repeat = atoi(argv[first] + 9);
+        } else {
+            break;
+        }
+    }
+    if (first >= argc || repeat < 1) {
+        printf("Usage: %s [--socket=PATH] [--repeat=R] \"request\" [\"request\" ...]\n", argv[0]);
+        exit(1);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        printf("Could not connect to %s\n", socket_path);
+        exit(1);
+    }
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // The whole request stream
+    size_t total = 0, sent = 0;
+    for (int k = first; k < argc; k++) {
+        total += (strlen(argv[k]) + 1) * repeat;
+    }
+    char *requests = (char *) malloc(total), *p = requests;
+    if (requests == NULL) {
+        printf("Allocation of %zu bytes of requests failed!\n", total);
+        exit(1);
+    }
+    for (int r = 0; r < repeat; r++) {
+        for (int k = first; k < argc; k++) {
+            size_t len = strlen(argv[k]);
+            memcpy(p, argv[k], len);
+            p[len] = '\n';
+            p += len + 1;
+        }
+    }
+
+    // Write and read together; one reply line per request
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int expect = repeat * (argc - first), replies = 0;
+    while (replies < expect) {
+        struct pollfd pfd = { fd, POLLIN | (sent < total ? POLLOUT : 0), 0 };
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pfd.revents & POLLOUT) {
+            ssize_t n = send(fd, requests + sent, total - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += n;
+            } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                break;
+            }
+        }
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            char buf[65536];
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            fwrite(buf, 1, n, stdout);
+            for (ssize_t i = 0; i < n; i++) {
+                replies += buf[i] == '\n';
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    close(fd);
+    free(requests);
+
+    if (replies < expect) {
+        printf("Connection closed after %d of %d replies\n", replies, expect);
+    }
+    printf("%-25s: %.4f (%d requests)\n", "Round trip (s)", elapsed(start, stop), expect);
+}
@@ -0,0 +1,494 @@
+// Resident grid service: x is allocated and initialised once, then smooth/count
+// requests are served over a Unix domain socket
+//
+// usage: a.out_gridd [--size=N] [--socket=PATH] [--threads=T] [--kernel=NAME] [--batch-ms=M]
+//
+// Protocol: one request per line, one reply line per request.
+//   smooth <a> <b> <c> <t1>[,<t2>,...]
+//       -> ok a=.. b=.. c=.. batch=<k> smooth_s=.. count_s=.. | t=<t1> x=<n> y=<n> | ...
+//   info      -> ok size=<n> threads=<t> kernel=<name> served=<requests>
+//   shutdown  -> ok, and the daemon exits
+//   anything else -> err <reason>
+//
+// Requests that are queued at the same time (from one or several clients)
+// form a batch: requests with the same (a, b, c) share one smoothing pass
+// and each distinct threshold of the group is counted once with count().
+// x never changes, so its counts are cached across batches.  (A grid_hist
+// pass with the thresholds as edges was measured slower than a count() per
+// threshold at the handful of thresholds a request carries.)
+// After the first request of a batch arrives the daemon waits up to
+// --batch-ms for more.  The process, its arrays and its OpenMP thread team
+// live as long as the daemon, so a request pays for none of the
+// allocation, page faults or initialize() of a part1 run.
+// A client that disconnects before its reply is sent is dropped; SIGPIPE
+// is ignored so that does not take the daemon down.
+// Client sockets are non-blocking.  Replies are appended to the client's
+// output buffer and sent as the socket accepts them; a client with more
+// than OUT_HIGH bytes unsent is not read from until it drains, so a client
+// that writes without reading cannot stall the daemon or grow its buffer
+// without bound.
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+#define MAX_CLIENTS    64
+#define MAX_PENDING    256
+#define MAX_THRESHOLDS 32
+#define LINE_MAX_LEN   1024
+#define X_CACHE        256
+#define OUT_HIGH       (64 * 1024)     // stop reading a client with this much unsent
+
+typedef struct {
+    int fd;
+    long gen;                   // connection number, unique per accept()
+    char buf[LINE_MAX_LEN];
+    size_t len;
+    char *out;                  // replies not yet accepted by the socket
+    size_t out_len, out_cap;
+} client_t;
+
+typedef struct {
+    int client;                 // index into clients[]
+    long gen;                   // to detect a slot reused by a new client
+    float a, b, c;
+    float thresholds[MAX_THRESHOLDS];
+    int nthresholds;
+    char reply[4096];
+    int done;
+} request_t;
+
+static client_t clients[MAX_CLIENTS];
+static request_t pending[MAX_PENDING];
+static int npending;
+static long connections;
+static struct timespec batch_first;     // when the oldest queued request arrived
+static float x_cache_t[X_CACHE];
+static long x_cache_n[X_CACHE];
+static int x_cached;
+
+// Cells of x below t; x is read-only, so each threshold is counted once
+static long x_below(float *x, long n, float t) {
+    for (int k = 0; k < x_cached; k++) {
+        if (x_cache_t[k] == t) {
+            return x_cache_n[k];
+        }
+    }
+    long below;
+    count(x, n, t, &below);
+    if (x_cached < X_CACHE) {
+        x_cache_t[x_cached] = t;
+        x_cache_n[x_cached++] = below;
+    }
+    return below;
+}
+
+static void drop_client(int k) {
+    close(clients[k].fd);
+    free(clients[k].out);
+    clients[k].fd = -1;
+    clients[k].len = 0;
+    clients[k].out = NULL;
+    clients[k].out_len = clients[k].out_cap = 0;
+}
+
+// Send as much of client k's output as the socket takes.  0 if the client
+// is still connected, -1 if it has gone (EPIPE, reset, ...) and was dropped.
+static int flush_client(int k) {
+    client_t *cl = &clients[k];
+    size_t sent = 0;
+
+    while (sent < cl->out_len) {
+        ssize_t n = send(cl->fd, cl->out + sent, cl->out_len - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            drop_client(k);
+            return -1;
+        }
+    }
+    cl->out_len -= sent;
+    memmove(cl->out, cl->out + sent, cl->out_len);
+    return 0;
+}
+
+// Append line and a newline to client k's output; -1 (client dropped) if out of memory
+static int queue_line(int k, const char *line) {
+    client_t *cl = &clients[k];
+    size_t len = strlen(line);
+
+    if (cl->out_len + len + 1 > cl->out_cap) {
+        size_t cap = cl->out_cap ? cl->out_cap : 4096;
+        while (cap < cl->out_len + len + 1) {
+            cap *= 2;
+        }
+        char *out = (char *) realloc(cl->out, cap);
+        if (out == NULL) {
+            drop_client(k);
+            return -1;
+        }
+        cl->out = out;
+        cl->out_cap = cap;
+    }
+    memcpy(cl->out + cl->out_len, line, len);
+    cl->out[cl->out_len + len] = '\n';
+    cl->out_len += len + 1;
+    return 0;
+}
+
+// Parse "smooth a b c t1,t2,..." into a request; 0 on success
+static int parse_smooth(const char *line, request_t *r) {
+    char list[LINE_MAX_LEN];
+    if (sscanf(line, "smooth %f %f %f %1023s", &r->a, &r->b, &r->c, list) != 4) {
+        return -1;
+    }
+    r->nthresholds = 0;
+    for (char *tok = strtok(list, ","); tok != NULL && r->nthresholds < MAX_THRESHOLDS; tok = strtok(NULL, ",")) {
+        r->thresholds[r->nthresholds++] = atof(tok);
+    }
+    return r->nthresholds > 0 ? 0 : -1;
+}
+
+// Run every queued request.  Requests with equal coefficients are grouped
+// so they share one smooth and one count per distinct threshold.
+static void run_batch(const smooth_kernel_t *kernel, float *x, float *y, long n) {
+    struct timespec start, stop;
+
+    for (int r = 0; r < npending; r++) {
+        if (pending[r].done) {
+            continue;
+        }
+
+        // Group: every pending request with the same (a, b, c)
+        float edges[MAX_PENDING * MAX_THRESHOLDS];
+        int nedges = 0, members = 0;
+        for (int q = r; q < npending; q++) {
+            if (!pending[q].done && pending[q].a == pending[r].a &&
+                pending[q].b == pending[r].b && pending[q].c == pending[r].c) {
+                for (int k = 0; k < pending[q].nthresholds; k++) {
+                    int e = 0;
+                    while (e < nedges && edges[e] != pending[q].thresholds[k]) {
+                        e++;
+                    }
+                    if (e == nedges) {
+                        edges[nedges++] = pending[q].thresholds[k];
+                    }
+                }
+                members++;
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kernel->smooth(x, y, n, pending[r].a, pending[r].b, pending[r].c);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        double smooth_time = elapsed(start, stop);
+
+        // y below each distinct threshold, then x (cached)
+        long y_counts[MAX_PENDING * MAX_THRESHOLDS], x_counts[MAX_PENDING * MAX_THRESHOLDS];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int e = 0; e < nedges; e++) {
+            count(y, n, edges[e], &y_counts[e]);
+        }
+        for (int e = 0; e < nedges; e++) {
+            x_counts[e] = x_below(x, n, edges[e]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        double count_time = elapsed(start, stop);
+
+        float a = pending[r].a, b = pending[r].b, c = pending[r].c;
+        for (int q = r; q < npending; q++) {
+            request_t *p = &pending[q];
+            if (p->done || p->a != a || p->b != b || p->c != c) {
+                continue;
+            }
+            int len = snprintf(p->reply, sizeof(p->reply),
+                               "ok a=%g b=%g c=%g batch=%d smooth_s=%.4f count_s=%.4f",
+                               a, b, c, members, smooth_time, count_time);
+            for (int k = 0; k < p->nthresholds && len < (int) sizeof(p->reply); k++) {
+                int e = 0;
+                while (edges[e] != p->thresholds[k]) {
+                    e++;
+                }
+                len += snprintf(p->reply + len, sizeof(p->reply) - len, " | t=%g x=%ld y=%ld",
+                                p->thresholds[k], x_counts[e], y_counts[e]);
+            }
+            p->done = 1;
+        }
+
+    }
+
+    // Replies go out in arrival order, to the connection that asked
+    for (int r = 0; r < npending; r++) {
+        client_t *cl = &clients[pending[r].client];
+        if (cl->fd >= 0 && cl->gen == pending[r].gen) {
+            queue_line(pending[r].client, pending[r].reply);
+        }
+    }
+    npending = 0;
+    for (int k = 0; k < MAX_CLIENTS; k++) {
+        if (clients[k].fd >= 0 && clients[k].out_len > 0) {
+            flush_client(k);
+        }
+    }
+}
+
+// Read what client k has sent and queue its complete lines; a full queue is
+// run first, so every line gets a slot.  Returns 1 if a shutdown was
+// requested; its reply goes out with the final batch.
+static int read_client(int k, const smooth_kernel_t *kernel, float *x, float *y, long n, long *served) {
+    client_t *cl = &clients[k];
+    long gen = cl->gen;
+    ssize_t got = read(cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - cl->len);
+
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    if (got <= 0) {
+        drop_client(k);
+        return 0;
+    }
+    cl->len += got;
+    cl->buf[cl->len] = '\0';
+
+    char *line = cl->buf, *nl;
+    int stop = 0;
+    while ((nl = strchr(line, '\n')) != NULL) {
+        *nl = '\0';
+        if (line[0] == '\0') {
+            line = nl + 1;
+            continue;
+        }
+        if (npending == MAX_PENDING) {
+            run_batch(kernel, x, y, n);
+            if (cl->fd < 0 || cl->gen != gen) {
+                return stop;
+            }
+        }
+
+        // Every request takes a queue slot so replies keep the request order
+        if (npending == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &batch_first);
+        }
+        request_t *r = &pending[npending++];
+        r->client = k;
+        r->gen = gen;
+        r->done = 1;
+        if (strncmp(line, "smooth ", 7) == 0) {
+            if (parse_smooth(line, r) == 0) {
+                r->done = 0;
+                (*served)++;
+            } else {
+                strcpy(r->reply, "err bad smooth request");
+            }
+        } else if (strcmp(line, "info") == 0) {
+            snprintf(r->reply, sizeof(r->reply), "ok size=%ld threads=%d kernel=%s served=%ld",
+                     n, omp_get_max_threads(), kernel->name, *served);
+        } else if (strcmp(line, "shutdown") == 0) {
+            strcpy(r->reply, "ok");
+            stop = 1;
+        } else {
+            strcpy(r->reply, "err unknown request");
+        }
+        line = nl + 1;
+    }
+
+    // Keep the partial line; drop a line that can never fit
+    cl->len = strlen(line);
+    memmove(cl->buf, line, cl->len);
+    if (cl->len == sizeof(cl->buf) - 1) {
+        if (queue_line(k, "err line too long") == 0 && flush_client(k) == 0) {
+            drop_client(k);
+        }
+    }
+    return stop;
+}
+
+int main(int argc, char *argv[]) {
+
+    long array_size = 98306;
+    const char *socket_path = "/tmp/gridd.sock";
+    const char *kernel_name = "auto";
+    int batch_ms = 5;
+
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strncmp(argv[k], "--socket=", 9) == 0) {
+            socket_path = argv[k] + 9;
+        } else if (strncmp(argv[k], "--threads=", 10) == 0) {
+            omp_set_num_threads(atoi(argv[k] + 10));
+        } else if (strncmp(argv[k], "--kernel=", 9) == 0) {
+            kernel_name = argv[k] + 9;
+        } else if (strncmp(argv[k], "--batch-ms=", 11) == 0) {
+            batch_ms = atoi(argv[k] + 11);
+        } else {
+            printf("Usage: %s [--size=N] [--socket=PATH] [--threads=T] [--kernel=NAME] [--batch-ms=M]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    const smooth_kernel_t *kernel = smooth_kernel_select(kernel_name);
+    if (kernel == NULL) {
+        printf("Kernel %s is unknown or not supported on this CPU\n", kernel_name);
+        exit(1);
+    }
+
+    // The one-time cost a part1 run pays on every invocation
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    float *x = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    float *y = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    if (x == NULL || y == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+    initialize(x, array_size);
+    copy_border(x, y, array_size);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    // A client may hang up before its reply; send() reports EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    unlink(socket_path);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(lfd, 16) != 0) {
+        printf("Could not listen on %s: %s\n", socket_path, strerror(errno));
+        exit(1);
+    }
+
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %.3f\n", "CPU: Alloc+Init (once)", elapsed(start, stop));
+    printf("%-45s: %s\n", "Smoothing kernel", kernel->name);
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    printf("%-45s: %s\n", "Listening on", socket_path);
+    fflush(stdout);
+
+    for (int k = 0; k < MAX_CLIENTS; k++) {
+        clients[k].fd = -1;
+    }
+
+    long served = 0;
+    int stop_requested = 0;
+    while (!stop_requested) {
+        struct pollfd fds[MAX_CLIENTS + 1];
+        int map[MAX_CLIENTS + 1], nfds = 0;
+
+        fds[nfds].fd = lfd;
+        fds[nfds].events = POLLIN;
+        map[nfds++] = -1;
+        for (int k = 0; k < MAX_CLIENTS; k++) {
+            if (clients[k].fd >= 0) {
+                fds[nfds].fd = clients[k].fd;
+                fds[nfds].events = (clients[k].out_len < OUT_HIGH ? POLLIN : 0) |
+                                   (clients[k].out_len > 0 ? POLLOUT : 0);
+                map[nfds++] = k;
+            }
+        }
+
+        // Block while idle; once a batch has started, wait for more only
+        // until batch_ms after its first request
+        int timeout = -1;
+        if (npending > 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timeout = batch_ms - (int) (1000.0 * elapsed(batch_first, now));
+            if (timeout <= 0) {
+                run_batch(kernel, x, y, array_size);
+                continue;
+            }
+        }
+        int ready = poll(fds, nfds, timeout);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready <= 0) {
+            if (npending > 0) {
+                run_batch(kernel, x, y, array_size);
+            }
+            continue;
+        }
+
+        for (int f = 0; f < nfds; f++) {
+            if (map[f] >= 0 && (fds[f].revents & POLLOUT) && clients[map[f]].fd >= 0) {
+                flush_client(map[f]);
+            }
+            if (!(fds[f].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            if (map[f] < 0) {
+                int cfd = accept(lfd, NULL, NULL);
+                int k = 0;
+                while (k < MAX_CLIENTS && clients[k].fd >= 0) {
+                    k++;
+                }
+                if (cfd >= 0 && k < MAX_CLIENTS) {
+                    fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+                    clients[k].fd = cfd;
+                    clients[k].gen = ++connections;
+                    clients[k].len = 0;
+                } else if (cfd >= 0) {
+                    const char *full = "err too many clients\n";
+                    send(cfd, full, strlen(full), MSG_NOSIGNAL | MSG_DONTWAIT);
+                    close(cfd);
+                }
+            } else if (clients[map[f]].fd >= 0) {     // not dropped by a batch run above
+                stop_requested |= read_client(map[f], kernel, x, y, array_size, &served);
+            }
+        }
+
+        if (npending >= MAX_PENDING) {
+            run_batch(kernel, x, y, array_size);
+        }
+    }
+
+    if (npending > 0) {
+        run_batch(kernel, x, y, array_size);
+    }
+
+    // Give the final replies (the shutdown's "ok" among them) up to a second to go out
+    for (int wait = 0; wait < 100; wait++) {
+        struct pollfd fds[MAX_CLIENTS];
+        int map[MAX_CLIENTS], nfds = 0;
+        for (int k = 0; k < MAX_CLIENTS; k++) {
+            if (clients[k].fd >= 0 && clients[k].out_len > 0) {
+                fds[nfds].fd = clients[k].fd;
+                fds[nfds].events = POLLOUT;
+                map[nfds++] = k;
+            }
+        }
+        if (nfds == 0 || poll(fds, nfds, 10) < 0) {
+            break;
+        }
+        for (int f = 0; f < nfds; f++) {
+            if (fds[f].revents) {
+                flush_client(map[f]);
+            }
+        }
+    }
+    for (int k = 0; k < MAX_CLIENTS; k++) {
+        if (clients[k].fd >= 0) {
+            drop_client(k);
+        }
+    }
+    close(lfd);
+    unlink(socket_path);
+    grid_free(x);
+    grid_free(y);
+}
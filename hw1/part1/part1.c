@@ -1,16 +1,69 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <omp.h>
 
-// Declaration of subroutines
-void initialize(float *, long);
-void smooth(float *, float *, long, float, float, float);
-void count(float *, long, float, long *);
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Smoothing kernel: --kernel=auto|avx512|avx2|sse|scalar|baseline|stencil9
+    // Extra reduced-precision run: --storage=fp16|bf16
+    // More thresholds answered from one histogram pass: --thresholds=t1,t2,...
+    // Problem size and team: --size=N, --threads=T (see bench.c for sweeps)
+    // Rectangle-count index of y (block summed-area table): --index
+    // Grid files: --load-x=PATH instead of initialize(), --save-x/--save-y=PATH
+    // written with --codec=none|shuffle-lz|xor-lz (default shuffle-lz)
+    const char *kernel_name = "auto";
+    int build_index = 0;
+    const char *load_x = NULL, *save_x = NULL, *save_y = NULL;
+    int codec = GRID_CODEC_SHUFFLE_LZ;
+    long array_size = 98306;
+    int num_threads = 8;
+    storage_t storage = STORE_FP32;
+    float thresholds[64];
+    int nthresholds = 0;
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--kernel=", 9) == 0) {
+            kernel_name = argv[k] + 9;
+        } else if (strncmp(argv[k], "--storage=", 10) == 0 && storage_parse(argv[k] + 10, &storage) == 0) {
+            continue;
+        } else if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strncmp(argv[k], "--threads=", 10) == 0) {
+            num_threads = atoi(argv[k] + 10);
+        } else if (strcmp(argv[k], "--index") == 0) {
+            build_index = 1;
+        } else if (strncmp(argv[k], "--load-x=", 9) == 0) {
+            load_x = argv[k] + 9;
+        } else if (strncmp(argv[k], "--save-x=", 9) == 0) {
+            save_x = argv[k] + 9;
+        } else if (strncmp(argv[k], "--save-y=", 9) == 0) {
+            save_y = argv[k] + 9;
+        } else if (strncmp(argv[k], "--codec=", 8) == 0 && grid_codec_parse(argv[k] + 8, &codec) == 0) {
+            continue;
+        } else if (strncmp(argv[k], "--thresholds=", 13) == 0) {
+            for (char *tok = strtok(argv[k] + 13, ","); tok != NULL && nthresholds < 63; tok = strtok(NULL, ",")) {
+                thresholds[nthresholds++] = atof(tok);
+            }
+        } else {
+            printf("Usage: %s [--kernel=auto|avx512|avx2|sse|scalar|baseline|stencil9] [--storage=fp16|bf16]"
+                   " [--thresholds=t1,t2,...] [--size=N] [--threads=T] [--index]"
+                   " [--load-x=PATH] [--save-x=PATH] [--save-y=PATH] [--codec=none|shuffle-lz|xor-lz]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    const smooth_kernel_t *kernel = smooth_kernel_select(kernel_name);
+    if (kernel == NULL) {
+        printf("Kernel %s is unknown or not supported on this CPU\n", kernel_name);
+        exit(1);
+    }
 
-void main() {
     #ifdef _OPENMP
-    omp_set_num_threads(8);
+    omp_set_num_threads(num_threads);
     #endif
     // Dummy parallel region
     #pragma omp parallel
@@ -25,13 +78,14 @@ void main() {
     const float b = 0.1;
     const float c = 0.4;
     const float threshold = 0.1;
-    const long array_size = 98306;
 
     // Declaration of variables
     float *x_array;
     float *y_array;
     long x_below_elements;
     long y_below_elements;
+    long x_below_fused;
+    long y_below_fused;
     double num_elements = array_size * array_size;
     double num_in_elements = (array_size - 2) * (array_size - 2);
 
@@ -43,26 +97,42 @@ void main() {
     double smooth_time;
     double count_x_time;
     double count_y_time;
+    double fused_time;
+    double hist_time;
 
 
     // Allocation of arrays
     printf("Allocating arrays . . .");
     clock_gettime(CLOCK_MONOTONIC, &start);
-    x_array = (float *) malloc(array_size * array_size * sizeof(float));
+    x_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
     clock_gettime(CLOCK_MONOTONIC, &stop);
     alloc_x_time = (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) / 1000000000;
 
     clock_gettime(CLOCK_MONOTONIC, &start);
-    y_array = (float *) malloc(array_size * array_size * sizeof(float));
+    y_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
     clock_gettime(CLOCK_MONOTONIC, &stop);
     alloc_y_time = (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) / 1000000000;
     printf(" OK\n");
+    if (x_array == NULL || y_array == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
 
 
     // Initialize x_array
     printf("Initalizing arrays . . .");
     clock_gettime(CLOCK_MONOTONIC, &start);
-    initialize(x_array, array_size);
+    if (load_x != NULL) {
+        grid_file_header_t header;
+        if (grid_file_info(load_x, &header) != 0 || (long) header.rows != array_size ||
+            (long) header.cols != array_size ||
+            grid_file_read(load_x, x_array, 0, 0, array_size, array_size) != 0) {
+            printf("\nCould not load a %ld x %ld grid from %s\n", array_size, array_size, load_x);
+            exit(1);
+        }
+    } else {
+        initialize(x_array, array_size);
+    }
     clock_gettime(CLOCK_MONOTONIC, &stop);
     init_x_time = (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) / 1000000000;
     printf(" OK\n");
@@ -79,7 +149,7 @@ void main() {
     // Smooth x_array to derive y_array
     printf("Smoothing x array . . .");
     clock_gettime(CLOCK_MONOTONIC, &start);
-    smooth(x_array, y_array, array_size, a, b, c);
+    kernel->smooth(x_array, y_array, array_size, a, b, c);
     clock_gettime(CLOCK_MONOTONIC, &stop);
     smooth_time = (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) / 1000000000;
     printf(" OK\n");
@@ -103,6 +173,63 @@ void main() {
     printf(" OK\n");
 
 
+    // Smooth x_array and count both arrays in a single pass
+    printf("Smoothing and counting (fused) . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    smooth_count(x_array, y_array, array_size, a, b, c, threshold, &x_below_fused, &y_below_fused);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    fused_time = (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) / 1000000000;
+    printf(" OK\n");
+
+
+    // Histograms of x and y: the main threshold plus any extra ones are bin
+    // edges, so every one of them is answered exactly from a single pass
+    grid_hist_t *x_hist, *y_hist;
+    thresholds[nthresholds] = threshold;
+    printf("Building histograms . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    x_hist = grid_hist_create(0.0, 10.0, 1000, thresholds, nthresholds + 1);
+    y_hist = grid_hist_create(0.0, 10.0, 1000, thresholds, nthresholds + 1);
+    if (x_hist == NULL || y_hist == NULL ||
+        grid_hist_build(x_hist, x_array, array_size) != 0 ||
+        grid_hist_build(y_hist, y_array, array_size) != 0) {
+        printf(" FAILED\n");
+        exit(-1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    hist_time = elapsed(start, stop);
+    printf(" OK\n");
+
+
+    // Index of y: rectangle counts without rescanning y
+    sat_block_t *y_index = NULL;
+    double index_time = 0;
+    if (build_index) {
+        printf("Building y index . . .");
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        y_index = sat_block_build(y_array, array_size, threshold, 16);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        index_time = elapsed(start, stop);
+        printf(y_index != NULL ? " OK\n" : " FAILED\n");
+    }
+
+
+    // Persist the grids for later stages
+    double save_time = 0;
+    if (save_x != NULL || save_y != NULL) {
+        printf("Saving arrays (%s) . . .", grid_codec_name(codec));
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if ((save_x != NULL && grid_file_write(save_x, x_array, array_size, array_size, 256, 256, codec) != 0) ||
+            (save_y != NULL && grid_file_write(save_y, y_array, array_size, array_size, 256, 256, codec) != 0)) {
+            printf(" FAILED\n");
+        } else {
+            printf(" OK\n");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        save_time = elapsed(start, stop);
+    }
+
+
     // Print outputs
     printf("---------- Summary ----------\n");
     printf("%-45s: %3d\n", "Number of elements in a row/column", array_size);
@@ -112,69 +239,135 @@ void main() {
     printf("%-45s: %3f\n", "Memory (GB) used per array", (sizeof(float) * num_elements) / 1073741824.0);
     printf("%-45s: %.3f\n", "Threshold", threshold);
     printf("%-45s: %.2f %.2f %.2f\n", "Smoothing constants (a, b, c)", a, b, c);
+    printf("%-45s: %s\n", "Smoothing kernel", kernel->name);
 
     printf("\n--- Inner Element Information ---\n");
     printf("%-45s: %ld\n", "Number   of elements below threshold (x)", x_below_elements);
     printf("%-45s: %3f\n", "Fraction of elements below threshold (x)", x_below_elements / num_in_elements);
     printf("%-45s: %ld\n", "Number   of elements below threshold (y)", y_below_elements);
     printf("%-45s: %3f\n", "Fraction of elements below threshold (y)", y_below_elements / num_in_elements);
+    if (x_below_fused != x_below_elements || y_below_fused != y_below_elements) {
+        printf("%-45s: %ld %ld\n", "WARNING: fused counts differ (x, y)", x_below_fused, y_below_fused);
+    }
+    if (grid_hist_count_below(x_hist, threshold, NULL) != x_below_elements ||
+        grid_hist_count_below(y_hist, threshold, NULL) != y_below_elements) {
+        printf("%-45s\n", "WARNING: histogram counts differ from count()");
+    }
+
+    if (y_index != NULL) {
+        long half = array_size / 2;
+        printf("%-45s: %ld\n", "Index: y below threshold, top-left quadrant",
+               sat_block_query(y_index, 0, 0, half, half));
+        if (sat_block_query(y_index, 0, 0, array_size, array_size) != y_below_elements) {
+            printf("%-45s\n", "WARNING: index total differs from count()");
+        }
+        sat_block_free(y_index);
+    }
+
+    printf("\n--- Histogram (one pass per array) ---\n");
+    for (int k = 0; k < nthresholds; k++) {
+        char label[64];
+        snprintf(label, sizeof(label), "Below %.4f (x, y)", thresholds[k]);
+        printf("%-45s: %ld %ld\n", label,
+               grid_hist_count_below(x_hist, thresholds[k], NULL),
+               grid_hist_count_below(y_hist, thresholds[k], NULL));
+    }
+    printf("%-45s: %.4f %.4f %.4f\n", "Quantiles of y (50%, 90%, 99%)",
+           grid_hist_quantile(y_hist, 0.5), grid_hist_quantile(y_hist, 0.9), grid_hist_quantile(y_hist, 0.99));
+    grid_hist_free(x_hist);
+    grid_hist_free(y_hist);
 
     printf("\n----- Action -----\n");
     printf("%-25s: %.3f\n", "CPU: Alloc-x", alloc_x_time);
     printf("%-25s: %.3f\n", "CPU: Alloc-y", alloc_y_time);
-    printf("%-25s: %.3f\n", "CPU: Init-x", init_x_time);
+    printf("%-25s: %.3f\n", load_x != NULL ? "CPU: Init-x (load)" : "CPU: Init-x", init_x_time);
     //printf("%-25s: %.3f\n", "CPU: Init-x 2", init_x_time2);
     printf("%-25s: %.3f\n", "CPU: Smooth", smooth_time);
     printf("%-25s: %.3f\n", "CPU: Count-x", count_x_time);
     printf("%-25s: %.3f\n", "CPU: Count-y", count_y_time);
+    printf("%-25s: %.3f\n", "CPU: Smooth+Count-x+y", smooth_time + count_x_time + count_y_time);
+    printf("%-25s: %.3f\n", "CPU: Fused smooth+counts", fused_time);
+    printf("%-25s: %.3f\n", "CPU: Histograms x+y", hist_time);
+    if (build_index) {
+        printf("%-25s: %.3f\n", "CPU: Index-y (block SAT)", index_time);
+    }
+    if (save_x != NULL || save_y != NULL) {
+        printf("%-25s: %.3f\n", "CPU: Save", save_time);
+    }
+
+    // Separate phases stream 4 arrays (smooth reads x and writes y, each
+    // count reads one array); the fused kernel streams only 2
+    printf("%-25s: %.2f\n", "GB/s: Separate phases",
+           4.0 * sizeof(float) * num_elements / 1073741824.0 / (smooth_time + count_x_time + count_y_time));
+    printf("%-25s: %.2f\n", "GB/s: Fused",
+           2.0 * sizeof(float) * num_elements / 1073741824.0 / fused_time);
 
     #ifdef _OPENMP
     printf("%-25s: %d\n", "OMP: Number of threads", omp_get_max_threads());
     #endif
+    grid_report("MEM: x_array pages", x_array);
+    grid_report("MEM: y_array pages", y_array);
 
 
     // Free memory
-    free(x_array);
-    free(y_array);
-}
+    grid_free(x_array);
+    grid_free(y_array);
 
-void initialize(float *array, long array_size) {
-    #pragma omp parallel for collapse(2) schedule(static)
-        for (int j = 0; j < array_size; j++) {
-            for (int i = 0; i < array_size; i++) {
-                array[i + j * array_size] = (float)abs(i % 11 - j % 5) / (i % 7 + j % 3 + 1);
-            }
-        }
-}
 
-void smooth(float *array, float *out_array, long array_size, float a, float b, float c) {
-    #pragma omp parallel for collapse(2) schedule(static)
-        for (int j = 1; j < array_size - 1; j++) {
-            for (int i = 1; i < array_size - 1; i++) {
-                out_array[i + j * array_size] = 
-                    a * (array[(i - 1) + (j - 1) * array_size] +
-                        array[(i - 1) + (j + 1) * array_size] +
-                        array[(i + 1) + (j - 1) * array_size] +
-                        array[(i + 1) + (j + 1) * array_size]) +
-                    b * (array[(i - 1) + j * array_size] +
-                        array[(i + 1) + j * array_size] +
-                        array[i + (j - 1) * array_size] +
-                        array[i + (j + 1) * array_size]) +
-                    c * (array[i + j * array_size]);
-            }
+    // Reduced-precision storage: redo the pipeline with 16-bit grids and
+    // compare the counts against the fp32 run above
+    if (storage != STORE_FP32) {
+        uint16_t *x_half, *y_half;
+        long x_below_half, y_below_half;
+        double init_h_time, smooth_h_time, count_x_h_time, count_y_h_time;
+
+        x_half = (uint16_t *) grid_alloc(array_size, array_size * sizeof(uint16_t));
+        y_half = (uint16_t *) grid_alloc(array_size, array_size * sizeof(uint16_t));
+        if (x_half == NULL || y_half == NULL) {
+            printf("Allocation of %s arrays failed!\n", storage_name(storage));
+            exit(-1);
         }
-} 
 
-void count(float *array, long array_size, float threshold, long *below_threshold) {
-    long temp = 0;
+        int status = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        status |= initialize_h(x_half, array_size, storage);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        init_h_time = elapsed(start, stop);
 
-    #pragma omp parallel for collapse(2) reduction(+:temp) schedule(static)
-        for (int j = 1; j < array_size - 1; j++) {
-            for (int i = 1; i < array_size - 1; i++) {
-                if (array[i + j * array_size] < threshold) {
-                    temp++;
-                }
-            }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        status |= smooth_h(x_half, y_half, array_size, a, b, c, storage);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        smooth_h_time = elapsed(start, stop);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        status |= count_h(x_half, array_size, threshold, storage, &x_below_half);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        count_x_h_time = elapsed(start, stop);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        status |= count_h(y_half, array_size, threshold, storage, &y_below_half);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        count_y_h_time = elapsed(start, stop);
+
+        if (status != 0) {
+            printf("Allocation of %s row buffers failed!\n", storage_name(storage));
+            exit(-1);
         }
-    *below_threshold = temp;
-}
\ No newline at end of file
+
+        printf("\n--- %s storage ---\n", storage_name(storage));
+        printf("%-45s: %3f\n", "Memory (GB) used per array", (sizeof(uint16_t) * num_elements) / 1073741824.0);
+        printf("%-45s: %ld (%+ld vs fp32)\n", "Number   of elements below threshold (x)",
+               x_below_half, x_below_half - x_below_elements);
+        printf("%-45s: %ld (%+ld vs fp32)\n", "Number   of elements below threshold (y)",
+               y_below_half, y_below_half - y_below_elements);
+        printf("%-45s: %.6f%%\n", "Relative count difference (y)",
+               100.0 * (y_below_half - y_below_elements) / (y_below_elements > 0 ? y_below_elements : 1));
+        printf("%-25s: %.3f\n", "CPU: Init-x", init_h_time);
+        printf("%-25s: %.3f\n", "CPU: Smooth", smooth_h_time);
+        printf("%-25s: %.3f\n", "CPU: Count-x", count_x_h_time);
+        printf("%-25s: %.3f\n", "CPU: Count-y", count_y_h_time);
+
+        grid_free(x_half);
+        grid_free(y_half);
+    }
+}
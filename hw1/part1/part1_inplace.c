@@ -0,0 +1,152 @@
+// In-place version of part1: only x is allocated and it is smoothed in place
+//
+// usage: a.out_part1_inplace [--size=N] [--verify]
+//   --verify  also run the out-of-place smooth() and compare y and the counts
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    long array_size = 98306;
+    int verify = 0;
+
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strcmp(argv[k], "--verify") == 0) {
+            verify = 1;
+        } else {
+            printf("Usage: %s [--size=N] [--verify]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    // Declaration of variables
+    float *x_array;
+    long x_below_elements;
+    long y_below_elements;
+    double num_elements = (double) array_size * array_size;
+    double num_in_elements = (double) (array_size - 2) * (array_size - 2);
+
+    struct timespec start, stop;
+    struct rusage usage;
+    double alloc_x_time;
+    double init_x_time;
+    double count_x_time;
+    double smooth_time;
+    double count_y_time;
+
+    // Allocation of x only
+    printf("Allocating x array . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    x_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    alloc_x_time = elapsed(start, stop);
+    if (x_array == NULL) {
+        printf("\nAllocation of x array failed!\n");
+        exit(-1);
+    }
+    printf(" OK\n");
+
+    // Initialize x_array
+    printf("Initalizing x array . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    initialize(x_array, array_size);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    init_x_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    // x must be counted before it is overwritten
+    printf("Counting x array . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    count(x_array, array_size, threshold, &x_below_elements);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    count_x_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    // Smooth x_array in place; it holds y from here on
+    printf("Smoothing x array in place . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (smooth_inplace(x_array, array_size, a, b, c) != 0) {
+        printf(" failed: no memory for the row buffers\n");
+        exit(-1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    smooth_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    printf("Counting y array . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    count(x_array, array_size, threshold, &y_below_elements);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    count_y_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    // Print outputs
+    printf("---------- Summary ----------\n");
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3.0f\n", "Total number of elements", num_elements);
+    printf("%-45s: %3.0f\n", "Total number of inner elements", num_in_elements);
+    printf("%-45s: %3f\n", "Memory (GB) used for x (and y)", (sizeof(float) * num_elements) / 1073741824.0);
+    printf("%-45s: %.1f\n", "Peak resident memory (MB)", usage.ru_maxrss / 1024.0);
+
+    printf("\n--- Inner Element Information ---\n");
+    printf("%-45s: %ld\n", "Number   of elements below threshold (x)", x_below_elements);
+    printf("%-45s: %3f\n", "Fraction of elements below threshold (x)", x_below_elements / num_in_elements);
+    printf("%-45s: %ld\n", "Number   of elements below threshold (y)", y_below_elements);
+    printf("%-45s: %3f\n", "Fraction of elements below threshold (y)", y_below_elements / num_in_elements);
+
+    printf("\n----- Action -----\n");
+    printf("%-25s: %.3f\n", "CPU: Alloc-x", alloc_x_time);
+    printf("%-25s: %.3f\n", "CPU: Init-x", init_x_time);
+    printf("%-25s: %.3f\n", "CPU: Count-x", count_x_time);
+    printf("%-25s: %.3f\n", "CPU: Smooth in place", smooth_time);
+    printf("%-25s: %.3f\n", "CPU: Count-y", count_y_time);
+    printf("%-25s: %.2f\n", "GB/s: Smooth in place",
+           2.0 * sizeof(float) * num_elements / 1073741824.0 / smooth_time);
+    #ifdef _OPENMP
+    printf("%-25s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    // Cross-check against the out-of-place pipeline
+    if (verify) {
+        float *x_ref = (float *) grid_alloc(array_size, array_size * sizeof(float));
+        float *y_ref = (float *) grid_alloc(array_size, array_size * sizeof(float));
+        long x_ref_below, y_ref_below;
+
+        if (x_ref == NULL || y_ref == NULL) {
+            printf("Allocation of verification arrays failed!\n");
+            exit(-1);
+        }
+        initialize(x_ref, array_size);
+        copy_border(x_ref, y_ref, array_size);
+        smooth(x_ref, y_ref, array_size, a, b, c);
+        count(x_ref, array_size, threshold, &x_ref_below);
+        count(y_ref, array_size, threshold, &y_ref_below);
+
+        int same = memcmp(y_ref, x_array, array_size * array_size * sizeof(float)) == 0;
+        printf("\n%-45s: %s\n", "Verify: y identical to out-of-place smooth", same ? "yes" : "NO");
+        printf("%-45s: %s\n", "Verify: counts match",
+               x_ref_below == x_below_elements && y_ref_below == y_below_elements ? "yes" : "NO");
+
+        grid_free(x_ref);
+        grid_free(y_ref);
+    }
+
+    // Free memory
+    grid_free(x_array);
+}
@@ -0,0 +1,298 @@
+// MPI (+ OpenMP) version of part1: 2D block decomposition with halo exchange
+//
+// usage: mpirun -np P a.out_part1_mpi [--size=N | --local=M]
+//   --size=N   strong scaling: the global grid is N x N
+//   --local=M  weak scaling: every rank owns an M x M block
+//
+// Each rank holds its block plus a one-cell halo.  The halo exchange is
+// posted with non-blocking sends/receives, the interior (cells that do not
+// read the halo) is smoothed while messages are in flight, and the
+// one-cell ring next to the halo is finished after MPI_Waitall.  Counts are
+// combined on rank 0 with MPI_Reduce.  Loops are OpenMP-parallel, so one
+// rank per socket with OMP_NUM_THREADS cores gives the hybrid mode.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+// Local block: rows [j0, j1) and columns [i0, i1) of the global grid,
+// stored with a one-cell halo as (ly + 2) x (lx + 2)
+typedef struct {
+    long nx, ny;          // global grid
+    long i0, i1, j0, j1;  // owned global range
+    long lx, ly;          // owned extent
+    long stride;          // lx + 2
+    int north, south, east, west;
+    int ne, nw, se, sw;
+    MPI_Comm comm;
+    MPI_Datatype column;
+} block_t;
+
+#define AT(blk, arr, li, lj) ((arr)[(li) + (lj) * (blk)->stride])
+
+static void split(long n, int parts, int idx, long *lo, long *hi) {
+    *lo = n * idx / parts;
+    *hi = n * (idx + 1) / parts;
+}
+
+static int neighbour(MPI_Comm comm, const int *dims, const int *coords, int dx, int dy) {
+    int c[2] = { coords[0] + dy, coords[1] + dx };
+    int rank;
+
+    if (c[0] < 0 || c[0] >= dims[0] || c[1] < 0 || c[1] >= dims[1]) {
+        return MPI_PROC_NULL;
+    }
+    MPI_Cart_rank(comm, c, &rank);
+    return rank;
+}
+
+static void setup_block(block_t *blk, long nx, long ny, int nranks) {
+    int dims[2] = { 0, 0 }, periods[2] = { 0, 0 }, coords[2];
+    int rank;
+
+    // dims[0] splits rows, dims[1] splits columns
+    MPI_Dims_create(nranks, 2, dims);
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &blk->comm);
+    MPI_Comm_rank(blk->comm, &rank);
+    MPI_Cart_coords(blk->comm, rank, 2, coords);
+
+    blk->nx = nx;
+    blk->ny = ny;
+    split(ny, dims[0], coords[0], &blk->j0, &blk->j1);
+    split(nx, dims[1], coords[1], &blk->i0, &blk->i1);
+    blk->lx = blk->i1 - blk->i0;
+    blk->ly = blk->j1 - blk->j0;
+    blk->stride = blk->lx + 2;
+
+    blk->north = neighbour(blk->comm, dims, coords, 0, -1);
+    blk->south = neighbour(blk->comm, dims, coords, 0, 1);
+    blk->west = neighbour(blk->comm, dims, coords, -1, 0);
+    blk->east = neighbour(blk->comm, dims, coords, 1, 0);
+    blk->nw = neighbour(blk->comm, dims, coords, -1, -1);
+    blk->ne = neighbour(blk->comm, dims, coords, 1, -1);
+    blk->sw = neighbour(blk->comm, dims, coords, -1, 1);
+    blk->se = neighbour(blk->comm, dims, coords, 1, 1);
+
+    MPI_Type_vector(blk->ly, 1, blk->stride, MPI_FLOAT, &blk->column);
+    MPI_Type_commit(&blk->column);
+}
+
+static void initialize_block(const block_t *blk, float *x) {
+    #pragma omp parallel for schedule(static)
+        for (long lj = 1; lj <= blk->ly; lj++) {
+            int j = blk->j0 + lj - 1;
+            for (long li = 1; li <= blk->lx; li++) {
+                int i = blk->i0 + li - 1;
+                AT(blk, x, li, lj) = (float)abs(i % 11 - j % 5) / (i % 7 + j % 3 + 1);
+            }
+        }
+}
+
+// Post the eight halo messages; requests are completed by the caller
+static void start_halo(const block_t *blk, float *x, MPI_Request *req) {
+    long lx = blk->lx, ly = blk->ly;
+    int n = 0;
+
+    MPI_Irecv(&AT(blk, x, 1, 0), lx, MPI_FLOAT, blk->north, 0, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, 1, ly + 1), lx, MPI_FLOAT, blk->south, 1, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, 0, 1), 1, blk->column, blk->west, 2, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, lx + 1, 1), 1, blk->column, blk->east, 3, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, 0, 0), 1, MPI_FLOAT, blk->nw, 4, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, lx + 1, 0), 1, MPI_FLOAT, blk->ne, 5, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, 0, ly + 1), 1, MPI_FLOAT, blk->sw, 6, blk->comm, &req[n++]);
+    MPI_Irecv(&AT(blk, x, lx + 1, ly + 1), 1, MPI_FLOAT, blk->se, 7, blk->comm, &req[n++]);
+
+    // Tags name the halo slot at the receiver
+    MPI_Isend(&AT(blk, x, 1, 1), lx, MPI_FLOAT, blk->north, 1, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, 1, ly), lx, MPI_FLOAT, blk->south, 0, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, 1, 1), 1, blk->column, blk->west, 3, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, lx, 1), 1, blk->column, blk->east, 2, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, 1, 1), 1, MPI_FLOAT, blk->nw, 7, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, lx, 1), 1, MPI_FLOAT, blk->ne, 6, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, 1, ly), 1, MPI_FLOAT, blk->sw, 5, blk->comm, &req[n++]);
+    MPI_Isend(&AT(blk, x, lx, ly), 1, MPI_FLOAT, blk->se, 4, blk->comm, &req[n++]);
+}
+
+// Smooth owned cells in local rows [lj0, lj1) and columns [li0, li1),
+// skipping the fixed outer ring of the global grid
+static void smooth_region(const block_t *blk, float *x, float *y, long li0, long li1,
+                          long lj0, long lj1, float a, float b, float c) {
+    // Clip to the global inner region
+    if (blk->i0 + li0 - 1 < 1) li0 = 2 - blk->i0;
+    if (blk->i0 + li1 - 1 > blk->nx - 1) li1 = blk->nx - blk->i0;
+    if (blk->j0 + lj0 - 1 < 1) lj0 = 2 - blk->j0;
+    if (blk->j0 + lj1 - 1 > blk->ny - 1) lj1 = blk->ny - blk->j0;
+
+    #pragma omp parallel for schedule(static)
+        for (long lj = lj0; lj < lj1; lj++) {
+            for (long li = li0; li < li1; li++) {
+                AT(blk, y, li, lj) = stencil9(&AT(blk, x, li, lj), blk->stride, a, b, c);
+            }
+        }
+}
+
+static long count_block(const block_t *blk, const float *x, float threshold) {
+    long li0 = blk->i0 == 0 ? 2 : 1, li1 = blk->i1 == blk->nx ? blk->lx : blk->lx + 1;
+    long lj0 = blk->j0 == 0 ? 2 : 1, lj1 = blk->j1 == blk->ny ? blk->ly : blk->ly + 1;
+    long temp = 0;
+
+    #pragma omp parallel for reduction(+:temp) schedule(static)
+        for (long lj = lj0; lj < lj1; lj++) {
+            for (long li = li0; li < li1; li++) {
+                temp += AT(blk, x, li, lj) < threshold;
+            }
+        }
+    return temp;
+}
+
+int main(int argc, char *argv[]) {
+    int provided, rank, nranks;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+    // The halo exchange overlaps OpenMP regions; MPI is called from the master thread only
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            printf("MPI library provides thread level %d, MPI_THREAD_FUNNELED (%d) is required\n",
+                   provided, MPI_THREAD_FUNNELED);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    long array_size = 98306;
+    long local_size = 0;
+
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strncmp(argv[k], "--local=", 8) == 0) {
+            local_size = atol(argv[k] + 8);
+        } else {
+            if (rank == 0) {
+                printf("Usage: %s [--size=N | --local=M]\n", argv[0]);
+            }
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
+    block_t blk;
+    long nx = array_size, ny = array_size;
+    if (local_size > 0) {
+        int dims[2] = { 0, 0 };
+        MPI_Dims_create(nranks, 2, dims);
+        nx = local_size * dims[1];
+        ny = local_size * dims[0];
+    }
+    setup_block(&blk, nx, ny, nranks);
+    MPI_Comm_rank(blk.comm, &rank);
+
+    // Declaration of variables
+    float *x_array;
+    float *y_array;
+    long x_below_local, y_below_local;
+    long x_below_elements = 0, y_below_elements = 0;
+    double num_elements = (double) nx * ny;
+    double num_in_elements = (double) (nx - 2) * (ny - 2);
+    size_t local_bytes = (blk.lx + 2) * (blk.ly + 2) * sizeof(float);
+
+    double t0, t1;
+    double times[5], max_times[5];  // init, halo wait, smooth, count-x, count-y
+    MPI_Request req[16];
+
+    x_array = (float *) grid_alloc(blk.ly + 2, (blk.lx + 2) * sizeof(float));
+    y_array = (float *) grid_alloc(blk.ly + 2, (blk.lx + 2) * sizeof(float));
+    if (x_array == NULL || y_array == NULL) {
+        printf("Rank %d: allocation of %zu bytes failed!\n", rank, 2 * local_bytes);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Initialize x_array
+    MPI_Barrier(blk.comm);
+    t0 = MPI_Wtime();
+    initialize_block(&blk, x_array);
+    t1 = MPI_Wtime();
+    times[0] = t1 - t0;
+
+    // Smooth: overlap the halo exchange with the interior
+    MPI_Barrier(blk.comm);
+    t0 = MPI_Wtime();
+    start_halo(&blk, x_array, req);
+    smooth_region(&blk, x_array, y_array, 2, blk.lx, 2, blk.ly, a, b, c);
+    double tw = MPI_Wtime();
+    MPI_Waitall(16, req, MPI_STATUSES_IGNORE);
+    times[1] = MPI_Wtime() - tw;
+    smooth_region(&blk, x_array, y_array, 1, blk.lx + 1, 1, 2, a, b, c);
+    if (blk.ly > 1) {
+        smooth_region(&blk, x_array, y_array, 1, blk.lx + 1, blk.ly, blk.ly + 1, a, b, c);
+    }
+    smooth_region(&blk, x_array, y_array, 1, 2, 2, blk.ly, a, b, c);
+    if (blk.lx > 1) {
+        smooth_region(&blk, x_array, y_array, blk.lx, blk.lx + 1, 2, blk.ly, a, b, c);
+    }
+    t1 = MPI_Wtime();
+    times[2] = t1 - t0;
+
+    // Count x_array
+    t0 = MPI_Wtime();
+    x_below_local = count_block(&blk, x_array, threshold);
+    t1 = MPI_Wtime();
+    times[3] = t1 - t0;
+
+    // Count y_array
+    t0 = MPI_Wtime();
+    y_below_local = count_block(&blk, y_array, threshold);
+    t1 = MPI_Wtime();
+    times[4] = t1 - t0;
+
+    MPI_Reduce(&x_below_local, &x_below_elements, 1, MPI_LONG, MPI_SUM, 0, blk.comm);
+    MPI_Reduce(&y_below_local, &y_below_elements, 1, MPI_LONG, MPI_SUM, 0, blk.comm);
+    MPI_Reduce(times, max_times, 5, MPI_DOUBLE, MPI_MAX, 0, blk.comm);
+
+    // Print outputs
+    if (rank == 0) {
+        printf("---------- Summary ----------\n");
+        printf("%-45s: %ld x %ld\n", "Number of elements in a row/column", nx, ny);
+        printf("%-45s: %3.0f\n", "Total number of elements", num_elements);
+        printf("%-45s: %3.0f\n", "Total number of inner elements", num_in_elements);
+        printf("%-45s: %3f\n", "Memory (GB) used per array per rank", local_bytes / 1073741824.0);
+        printf("%-45s: %.3f\n", "Threshold", threshold);
+        printf("%-45s: %.2f %.2f %.2f\n", "Smoothing constants (a, b, c)", a, b, c);
+
+        printf("\n--- Inner Element Information ---\n");
+        printf("%-45s: %ld\n", "Number   of elements below threshold (x)", x_below_elements);
+        printf("%-45s: %3f\n", "Fraction of elements below threshold (x)", x_below_elements / num_in_elements);
+        printf("%-45s: %ld\n", "Number   of elements below threshold (y)", y_below_elements);
+        printf("%-45s: %3f\n", "Fraction of elements below threshold (y)", y_below_elements / num_in_elements);
+
+        printf("\n----- Action (max over ranks) -----\n");
+        printf("%-25s: %.3f\n", "CPU: Init-x", max_times[0]);
+        printf("%-25s: %.3f\n", "CPU: Smooth", max_times[2]);
+        printf("%-25s: %.3f\n", "CPU: Halo wait", max_times[1]);
+        printf("%-25s: %.3f\n", "CPU: Count-x", max_times[3]);
+        printf("%-25s: %.3f\n", "CPU: Count-y", max_times[4]);
+        printf("%-25s: %d\n", "MPI: Number of ranks", nranks);
+        #ifdef _OPENMP
+        printf("%-25s: %d\n", "OMP: Threads per rank", omp_get_max_threads());
+        #endif
+    }
+
+    // Free memory
+    grid_free(x_array);
+    grid_free(y_array);
+    MPI_Type_free(&blk.column);
+    MPI_Comm_free(&blk.comm);
+    MPI_Finalize();
+    return 0;
+}
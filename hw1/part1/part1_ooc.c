@@ -0,0 +1,114 @@
+// Out-of-core version of part1: x and y are memory-mapped files processed in bands
+//
+// usage: a.out_part1_ooc [--size=N] [--band-mb=M] [--dir=PATH] [--keep]
+//   --band-mb=M  rows per band are chosen so one band is about M MB
+//   --dir=PATH   where x.grid and y.grid are written (default .)
+//   --keep       leave the grid files behind
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <omp.h>
+
+#include "grid.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    long array_size = 98306;
+    long band_mb = 256;
+    const char *dir = ".";
+    int keep = 0;
+
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strncmp(argv[k], "--band-mb=", 10) == 0) {
+            band_mb = atol(argv[k] + 10);
+        } else if (strncmp(argv[k], "--dir=", 6) == 0) {
+            dir = argv[k] + 6;
+        } else if (strcmp(argv[k], "--keep") == 0) {
+            keep = 1;
+        } else {
+            printf("Usage: %s [--size=N] [--band-mb=M] [--dir=PATH] [--keep]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    // Declaration of variables
+    char x_path[4096], y_path[4096];
+    long x_below_elements;
+    long y_below_elements;
+    long band_rows = ooc_band_rows(array_size, band_mb << 20);
+    double num_elements = (double) array_size * array_size;
+    double num_in_elements = (double) (array_size - 2) * (array_size - 2);
+
+    struct timespec start, stop;
+    struct rusage usage;
+    double init_x_time;
+    double smooth_time;
+
+    snprintf(x_path, sizeof(x_path), "%s/x.grid", dir);
+    snprintf(y_path, sizeof(y_path), "%s/y.grid", dir);
+
+    // Write x_array to disk band by band
+    printf("Initalizing x file . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (ooc_initialize(x_path, array_size, band_rows) != 0) {
+        printf("\nCould not write %s\n", x_path);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    init_x_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    // Smooth and count band by band
+    printf("Smoothing and counting bands . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (ooc_smooth_count(x_path, y_path, array_size, band_rows, a, b, c, threshold,
+                         &x_below_elements, &y_below_elements) != 0) {
+        printf("\nCould not map %s / %s\n", x_path, y_path);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    smooth_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    // Print outputs
+    printf("---------- Summary ----------\n");
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3.0f\n", "Total number of elements", num_elements);
+    printf("%-45s: %3.0f\n", "Total number of inner elements", num_in_elements);
+    printf("%-45s: %3f\n", "Disk (GB) used per array", (sizeof(float) * num_elements) / 1073741824.0);
+    printf("%-45s: %ld (%.1f MB)\n", "Rows per band", band_rows,
+           band_rows * array_size * sizeof(float) / 1048576.0);
+    printf("%-45s: %.1f\n", "Peak resident memory (MB)", usage.ru_maxrss / 1024.0);
+
+    printf("\n--- Inner Element Information ---\n");
+    printf("%-45s: %ld\n", "Number   of elements below threshold (x)", x_below_elements);
+    printf("%-45s: %3f\n", "Fraction of elements below threshold (x)", x_below_elements / num_in_elements);
+    printf("%-45s: %ld\n", "Number   of elements below threshold (y)", y_below_elements);
+    printf("%-45s: %3f\n", "Fraction of elements below threshold (y)", y_below_elements / num_in_elements);
+
+    printf("\n----- Action -----\n");
+    printf("%-25s: %.3f\n", "CPU: Init-x (write)", init_x_time);
+    printf("%-25s: %.3f\n", "CPU: Smooth+Count bands", smooth_time);
+    printf("%-25s: %.2f\n", "GB/s: Smooth+Count",
+           2.0 * sizeof(float) * num_elements / 1073741824.0 / smooth_time);
+    #ifdef _OPENMP
+    printf("%-25s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    if (!keep) {
+        unlink(x_path);
+        unlink(y_path);
+    }
+}
@@ -0,0 +1,145 @@
+// Procedural version of part1: x is generated from its period tile, never stored
+//
+// usage: a.out_part1_proc [--size=N] [--verify]
+//   --verify  also run the stored-x pipeline and compare y and both counts
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+#define MAX_PERIOD 256
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    long array_size = 98306;
+    int verify = 0;
+
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strcmp(argv[k], "--verify") == 0) {
+            verify = 1;
+        } else {
+            printf("Usage: %s [--size=N] [--verify]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    // Declaration of variables
+    float *y_array;
+    proc_grid_t pg;
+    long x_below_elements;
+    long y_below_elements;
+    double num_elements = (double) array_size * array_size;
+    double num_in_elements = (double) (array_size - 2) * (array_size - 2);
+
+    struct timespec start, stop;
+    double alloc_y_time;
+    double detect_time;
+    double count_x_time;
+    double smooth_time;
+
+    // Allocation of y only
+    printf("Allocating y array . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    y_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    alloc_y_time = elapsed(start, stop);
+    if (y_array == NULL) {
+        printf("\nAllocation of y array failed!\n");
+        exit(-1);
+    }
+    printf(" OK\n");
+
+    // Find the period tile of the generator
+    printf("Detecting generator period . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (proc_detect_period(grid_value, MAX_PERIOD, &pg) != 0) {
+        printf("\nGenerator is not periodic within %d cells\n", MAX_PERIOD);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    detect_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    // Count x in closed form
+    printf("Counting x array (closed form) . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    x_below_elements = proc_count(&pg, array_size, threshold);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    count_x_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    // Smooth the generated x and count y in the same pass
+    printf("Smoothing and counting y . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (proc_smooth_count(&pg, y_array, array_size, a, b, c, threshold, &y_below_elements) != 0) {
+        printf(" FAILED\n");
+        exit(-1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    smooth_time = elapsed(start, stop);
+    printf(" OK\n");
+
+    // Print outputs
+    printf("---------- Summary ----------\n");
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3.0f\n", "Total number of elements", num_elements);
+    printf("%-45s: %3.0f\n", "Total number of inner elements", num_in_elements);
+    printf("%-45s: %3f\n", "Memory (GB) used for y", (sizeof(float) * num_elements) / 1073741824.0);
+    printf("%-45s: %3f\n", "Memory (GB) used for the x row table",
+           (sizeof(float) * (double) pg.pj * array_size) / 1073741824.0);
+    printf("%-45s: %d x %d\n", "Generator period (columns x rows)", pg.pi, pg.pj);
+
+    printf("\n--- Inner Element Information ---\n");
+    printf("%-45s: %ld\n", "Number   of elements below threshold (x)", x_below_elements);
+    printf("%-45s: %3f\n", "Fraction of elements below threshold (x)", x_below_elements / num_in_elements);
+    printf("%-45s: %ld\n", "Number   of elements below threshold (y)", y_below_elements);
+    printf("%-45s: %3f\n", "Fraction of elements below threshold (y)", y_below_elements / num_in_elements);
+
+    printf("\n----- Action -----\n");
+    printf("%-25s: %.3f\n", "CPU: Alloc-y", alloc_y_time);
+    printf("%-25s: %.6f\n", "CPU: Detect period", detect_time);
+    printf("%-25s: %.6f\n", "CPU: Count-x (closed)", count_x_time);
+    printf("%-25s: %.3f\n", "CPU: Smooth+Count-y", smooth_time);
+    #ifdef _OPENMP
+    printf("%-25s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    // Cross-check against the stored-x pipeline
+    if (verify) {
+        float *x_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
+        float *y_ref = (float *) grid_alloc(array_size, array_size * sizeof(float));
+        long x_ref, y_ref_below;
+
+        if (x_array == NULL || y_ref == NULL) {
+            printf("Allocation of verification arrays failed!\n");
+            exit(-1);
+        }
+        initialize(x_array, array_size);
+        copy_border(x_array, y_ref, array_size);
+        smooth(x_array, y_ref, array_size, a, b, c);
+        count(x_array, array_size, threshold, &x_ref);
+        count(y_ref, array_size, threshold, &y_ref_below);
+
+        int same = memcmp(y_ref, y_array, array_size * array_size * sizeof(float)) == 0;
+        printf("\n%-45s: %s\n", "Verify: y identical to stored-x smooth", same ? "yes" : "NO");
+        printf("%-45s: %s\n", "Verify: counts match",
+               x_ref == x_below_elements && y_ref_below == y_below_elements ? "yes" : "NO");
+
+        grid_free(x_array);
+        grid_free(y_ref);
+    }
+
+    // Free memory
+    grid_free(y_array);
+}
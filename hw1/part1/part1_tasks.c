@@ -0,0 +1,147 @@
+// Task-graph version of part1: tile-level tasks instead of barriers between phases
+//
+// usage: a.out_part1_tasks [--size=N] [--tile=RxC]
+// Runs the usual bulk-synchronous phases first, then the task graph on the
+// same arrays, and compares counts, y and the timings of the two.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "grid.h"
+#include "grid_alloc.h"
+
+int main(int argc, char *argv[]) {
+
+    // Declaration of constants
+    const float a = 0.05;
+    const float b = 0.1;
+    const float c = 0.4;
+    const float threshold = 0.1;
+    long array_size = 98306;
+    long tile_rows = 64;
+    long tile_cols = 1024;
+
+    for (int k = 1; k < argc; k++) {
+        if (strncmp(argv[k], "--size=", 7) == 0) {
+            array_size = atol(argv[k] + 7);
+        } else if (strncmp(argv[k], "--tile=", 7) == 0 &&
+                   sscanf(argv[k] + 7, "%ldx%ld", &tile_rows, &tile_cols) == 2) {
+            continue;
+        } else {
+            printf("Usage: %s [--size=N] [--tile=RxC]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    // Declaration of variables
+    float *x_array;
+    float *y_array;
+    float *y_ref;
+    long x_below_elements, y_below_elements;
+    long x_below_tasks, y_below_tasks;
+    double num_elements = (double) array_size * array_size;
+
+    struct timespec start, stop;
+    double init_x_time;
+    double smooth_time;
+    double count_x_time;
+    double count_y_time;
+    double phases_time;
+    double tasks_time;
+    task_trace_t trace;
+
+    x_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    y_array = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    y_ref = (float *) grid_alloc(array_size, array_size * sizeof(float));
+    if (x_array == NULL || y_array == NULL || y_ref == NULL) {
+        printf("Allocation of arrays failed!\n");
+        exit(-1);
+    }
+
+    // Bulk-synchronous phases, as in part1
+    printf("Running sequential phases . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    initialize(x_array, array_size);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    init_x_time = elapsed(start, stop);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    copy_border(x_array, y_ref, array_size);
+    smooth(x_array, y_ref, array_size, a, b, c);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    smooth_time = elapsed(start, stop);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    count(x_array, array_size, threshold, &x_below_elements);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    count_x_time = elapsed(start, stop);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    count(y_ref, array_size, threshold, &y_below_elements);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    count_y_time = elapsed(start, stop);
+    phases_time = init_x_time + smooth_time + count_x_time + count_y_time;
+    printf(" OK\n");
+
+    // Same work as one task graph; x is rewritten from scratch
+    memset(x_array, 0, array_size * array_size * sizeof(float));
+    printf("Running task graph . . .");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status = task_smooth_count(x_array, y_array, array_size, tile_rows, tile_cols, a, b, c, threshold,
+                                   &x_below_tasks, &y_below_tasks, &trace);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    tasks_time = elapsed(start, stop);
+    if (status != 0) {
+        printf(" FAILED\n");
+        exit(-1);
+    }
+    printf(" OK\n");
+
+    // Print outputs
+    printf("---------- Summary ----------\n");
+    printf("%-45s: %ld\n", "Number of elements in a row/column", array_size);
+    printf("%-45s: %3f\n", "Memory (GB) used per array", (sizeof(float) * num_elements) / 1073741824.0);
+    printf("%-45s: %ld x %ld (%ld tiles)\n", "Tile size (rows x columns)", tile_rows, tile_cols, trace.ntiles);
+    printf("%-45s: %ld %ld\n", "Below threshold (x, y)", x_below_tasks, y_below_tasks);
+    printf("%-45s: %s\n", "Counts match sequential phases",
+           x_below_tasks == x_below_elements && y_below_tasks == y_below_elements ? "yes" : "NO");
+    printf("%-45s: %s\n", "y identical to sequential phases",
+           memcmp(y_ref, y_array, array_size * array_size * sizeof(float)) == 0 ? "yes" : "NO");
+
+    // When each phase ran inside the graph; busy is the summed task time
+    static const char *names[TASK_NPHASES] = { "init", "count-x", "smooth", "count-y" };
+    printf("\n--- Task graph phases (s from graph start) ---\n");
+    printf("%-10s %10s %10s %10s\n", "phase", "first", "last", "busy");
+    for (int p = 0; p < TASK_NPHASES; p++) {
+        double first, last, busy;
+        task_trace_phase(&trace, p, &first, &last, &busy);
+        printf("%-10s %10.4f %10.4f %10.4f\n", names[p], first, last, busy);
+    }
+    double init_first, init_last, smooth_first, smooth_last, cy_first, cy_last, busy;
+    task_trace_phase(&trace, TASK_INIT, &init_first, &init_last, &busy);
+    task_trace_phase(&trace, TASK_SMOOTH, &smooth_first, &smooth_last, &busy);
+    task_trace_phase(&trace, TASK_COUNT_Y, &cy_first, &cy_last, &busy);
+    printf("%-45s: %.1f%%\n", "Smooth started before init finished",
+           init_last > smooth_first ? 100.0 * (init_last - smooth_first) / (init_last - init_first) : 0.0);
+    printf("%-45s: %.1f%%\n", "Count-y started before smooth finished",
+           smooth_last > cy_first ? 100.0 * (smooth_last - cy_first) / (smooth_last - smooth_first) : 0.0);
+
+    printf("\n----- Action -----\n");
+    printf("%-25s: %.3f\n", "CPU: Init-x", init_x_time);
+    printf("%-25s: %.3f\n", "CPU: Smooth", smooth_time);
+    printf("%-25s: %.3f\n", "CPU: Count-x", count_x_time);
+    printf("%-25s: %.3f\n", "CPU: Count-y", count_y_time);
+    printf("%-25s: %.3f\n", "CPU: Sequential phases", phases_time);
+    printf("%-25s: %.3f\n", "CPU: Task graph", tasks_time);
+    printf("%-25s: %.2fx\n", "Speedup", phases_time / tasks_time);
+    #ifdef _OPENMP
+    printf("%-25s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    #endif
+
+    free(trace.spans);
+    grid_free(x_array);
+    grid_free(y_array);
+    grid_free(y_ref);
+}
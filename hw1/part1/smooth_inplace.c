@@ -0,0 +1,78 @@
+// In-place smoothing: x is overwritten with its smoothed values
+//
+// Each thread owns a contiguous band of inner rows [j0, j1).  Before anyone
+// writes, the thread saves the original rows just outside its band (j0 - 1
+// and j1, which the neighbouring bands will overwrite) and a barrier is
+// passed.  It then walks its band top to bottom with two rolling copies of
+// original rows: `up` (row j - 1) and `mid` (row j).  Row j + 1 is still
+// original in the grid, except at the bottom of the band where the saved
+// copy is used.  Per thread that is four rows of extra memory instead of a
+// second grid, and the arithmetic is smooth()'s, so the result is bit
+// identical to smooth() into a separate array.  The rows of all threads
+// are allocated before the parallel region; -1 if that fails (x untouched).
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+int smooth_inplace(float *array, long array_size, float a, float b, float c) {
+    size_t row_bytes = array_size * sizeof(float);
+    long inner = array_size - 2;
+    int max_threads = omp_get_max_threads();
+    float *rows = (float *) malloc(4 * max_threads * row_bytes);
+
+    if (rows == NULL) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(max_threads)
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        long j0 = 1 + inner * tid / nthreads;
+        long j1 = 1 + inner * (tid + 1) / nthreads;
+
+        float *above = rows + 4 * tid * array_size;
+        float *below = above + array_size;
+        float *up = below + array_size;
+        float *mid = up + array_size;
+
+        if (j0 < j1) {
+            memcpy(above, array + (j0 - 1) * array_size, row_bytes);
+            memcpy(below, array + j1 * array_size, row_bytes);
+        }
+
+        // Every band boundary is saved before any row is overwritten
+        #pragma omp barrier
+
+        if (j0 < j1) {
+            memcpy(up, above, row_bytes);
+            memcpy(mid, array + j0 * array_size, row_bytes);
+        }
+
+        for (long j = j0; j < j1; j++) {
+            const float *down = j + 1 < j1 ? array + (j + 1) * array_size : below;
+            float *out = array + j * array_size;
+
+            for (long i = 1; i < array_size - 1; i++) {
+                out[i] = a * (up[i - 1] + down[i - 1] + up[i + 1] + down[i + 1]) +
+                         b * (mid[i - 1] + mid[i + 1] + up[i] + down[i]) +
+                         c * mid[i];
+            }
+
+            // Roll: the original row j becomes `up`, row j + 1 (not yet
+            // overwritten) becomes `mid`
+            float *tmp = up;
+            up = mid;
+            mid = tmp;
+            if (j + 1 < j1) {
+                memcpy(mid, down, row_bytes);
+            }
+        }
+
+    }
+
+    free(rows);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Temporally blocked multi-sweep smoother
+//
+// smooth_n(x, y, n, a, b, c, nsteps) gives the same bits as calling smooth()
+// nsteps times while ping-ponging between x and y, but streams the grid
+// through DRAM once per SMOOTH_N_MAX_FUSE steps instead of once per step.
+//
+// Each pass cuts the inner region into tiles.  A thread copies its tile plus
+// an h-cell halo (h = steps fused in this pass) into two private buffers and
+// runs the h sweeps there; the valid region shrinks by one cell per sweep, so
+// after h sweeps exactly the tile itself is correct and gets written out.
+// Halo cells are recomputed by neighbouring tiles (overlapped-halo blocking).
+//
+// On return y holds the result and x has been used as the second buffer.
+// The tile buffers of all threads are allocated once, before the first
+// pass; smooth_n() returns -1 (x and y untouched) if that fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+#define TILE_ROWS 64
+#define TILE_COLS 512
+
+static long max_l(long p, long q) { return p > q ? p : q; }
+static long min_l(long p, long q) { return p < q ? p : q; }
+
+// Run h fused sweeps of src over one tile with output rows [j0, j1) and
+// columns [i0, i1), writing the tile into dst.
+static void smooth_tile(const float *src, float *dst, long array_size,
+                        long i0, long i1, long j0, long j1, int h,
+                        float a, float b, float c, float *buf0, float *buf1) {
+    // Loaded region, clipped to the grid
+    long li0 = max_l(i0 - h, 0), li1 = min_l(i1 + h, array_size);
+    long lj0 = max_l(j0 - h, 0), lj1 = min_l(j1 + h, array_size);
+    long stride = li1 - li0;
+
+    for (long j = lj0; j < lj1; j++) {
+        memcpy(buf0 + (j - lj0) * stride, src + li0 + j * array_size, stride * sizeof(float));
+        memcpy(buf1 + (j - lj0) * stride, src + li0 + j * array_size, stride * sizeof(float));
+    }
+
+    float *in = buf0, *out = buf1;
+    for (int s = 1; s <= h; s++) {
+        // Cells still valid after sweep s; the outer ring of the grid is fixed
+        long ui0 = max_l(i0 - h + s, 1), ui1 = min_l(i1 + h - s, array_size - 1);
+        long uj0 = max_l(j0 - h + s, 1), uj1 = min_l(j1 + h - s, array_size - 1);
+
+        for (long j = uj0; j < uj1; j++) {
+            const float *p = in + (j - lj0) * stride - li0;
+            float *q = out + (j - lj0) * stride - li0;
+            for (long i = ui0; i < ui1; i++) {
+                q[i] = stencil9(p + i, stride, a, b, c);
+            }
+        }
+        float *t = in; in = out; out = t;
+    }
+
+    for (long j = j0; j < j1; j++) {
+        memcpy(dst + i0 + j * array_size, in + (j - lj0) * stride + (i0 - li0),
+               (i1 - i0) * sizeof(float));
+    }
+}
+
+// Floats in one tile buffer for up to h fused sweeps
+static size_t tile_buf_len(int h) {
+    return (size_t) (TILE_ROWS + 2 * h) * (TILE_COLS + 2 * h);
+}
+
+// One pass of h fused sweeps from src into dst; bufs holds two tile
+// buffers of buf_len floats for each of nthreads threads
+static void smooth_pass(const float *src, float *dst, long array_size, int h,
+                        float a, float b, float c, float *bufs, size_t buf_len, int nthreads) {
+    long inner = array_size - 2;
+    long ntile_i = (inner + TILE_COLS - 1) / TILE_COLS;
+    long ntile_j = (inner + TILE_ROWS - 1) / TILE_ROWS;
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        float *buf0 = bufs + 2 * omp_get_thread_num() * buf_len;
+        float *buf1 = buf0 + buf_len;
+
+        // Row-major tile order keeps each thread's halo reads close together
+        #pragma omp for schedule(static)
+            for (long t = 0; t < ntile_i * ntile_j; t++) {
+                long j0 = 1 + (t / ntile_i) * TILE_ROWS;
+                long i0 = 1 + (t % ntile_i) * TILE_COLS;
+                long j1 = min_l(j0 + TILE_ROWS, array_size - 1);
+                long i1 = min_l(i0 + TILE_COLS, array_size - 1);
+                smooth_tile(src, dst, array_size, i0, i1, j0, j1, h, a, b, c, buf0, buf1);
+            }
+    }
+}
+
+int smooth_n(float *x, float *y, long array_size, float a, float b, float c, int nsteps) {
+    if (nsteps < 1 || array_size < 3) {
+        return 0;
+    }
+
+    // Passes alternate x->y, y->x, ... so an odd pass count ends in y
+    int passes = (nsteps + SMOOTH_N_MAX_FUSE - 1) / SMOOTH_N_MAX_FUSE;
+    if (passes % 2 == 0) {
+        passes++;
+    }
+
+    // Buffers for the widest halo any pass uses
+    int nthreads = omp_get_max_threads();
+    size_t buf_len = tile_buf_len((nsteps + passes - 1) / passes);
+    float *bufs = (float *) malloc(2 * nthreads * buf_len * sizeof(float));
+    if (bufs == NULL) {
+        return -1;
+    }
+
+    copy_border(x, y, array_size);
+
+    float *src = x, *dst = y;
+    int done = 0;
+    for (int p = 0; p < passes; p++) {
+        // Spread the steps evenly so no pass carries an oversized halo
+        int h = (nsteps - done) / (passes - p);
+        smooth_pass(src, dst, array_size, h, a, b, c, bufs, buf_len, nthreads);
+        done += h;
+        float *t = src; src = dst; dst = t;
+    }
+
+    free(bufs);
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Hand-vectorised 9-point smoothing kernels with runtime ISA dispatch
+//
+// Every variant walks the grid row by row with unit stride.  Each thread owns
+// a contiguous band of rows and keeps the horizontal pair sums
+// h[i] = row[i-1] + row[i+1] of the last three rows in a small rolling
+// buffer, so a loaded row feeds all three vertical taps:
+//
+//   out[j] = a * (h[j-1] + h[j+1]) + b * (h[j] + mid[j-1] + mid[j+1]) + c * mid[j]
+//
+// The regrouped sums (and FMA in the AVX2/AVX-512 variants) round
+// differently from smooth(), so results agree with it to a few ulp rather
+// than bit for bit.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "grid.h"
+
+#define ROW_ALIGN 64
+
+// Signature shared by all per-row kernels: compute out[1 .. n-2] of row j
+// from the up/mid/down rows, the pair sums of rows j-1 and j, and store the
+// pair sums of row j+1 into h_down on the way.
+typedef void (*row_fn)(const float *, const float *, const float *,
+                       const float *, const float *, float *, float *,
+                       long, float, float, float);
+
+static inline void pair_sums(const float *row, float *h, long array_size) {
+    for (long i = 1; i < array_size - 1; i++) {
+        h[i] = row[i - 1] + row[i + 1];
+    }
+}
+
+static inline float rolled(const float *up, const float *mid, const float *down,
+                           const float *h_up, const float *h_mid, float *h_down,
+                           long i, float a, float b, float c) {
+    float hd = down[i - 1] + down[i + 1];
+    h_down[i] = hd;
+    return a * (h_up[i] + hd) + b * (h_mid[i] + up[i] + down[i]) + c * mid[i];
+}
+
+static void row_scalar(const float *up, const float *mid, const float *down,
+                       const float *h_up, const float *h_mid, float *h_down, float *out,
+                       long array_size, float a, float b, float c) {
+    for (long i = 1; i < array_size - 1; i++) {
+        out[i] = rolled(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+}
+
+// Peel scalar iterations until out + i sits on a `width`-float boundary
+static inline long peel_end(const float *out, long width, long array_size) {
+    long i = 1;
+    while (i < array_size - 1 && ((size_t) (out + i) & (width * sizeof(float) - 1)) != 0) {
+        i++;
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static void row_sse(const float *up, const float *mid, const float *down,
+                    const float *h_up, const float *h_mid, float *h_down, float *out,
+                    long array_size, float a, float b, float c) {
+    long i = 1, start = peel_end(out, 4, array_size);
+    for (; i < start; i++) {
+        out[i] = rolled(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+
+    __m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), vc = _mm_set1_ps(c);
+    for (; i + 4 <= array_size - 1; i += 4) {
+        __m128 hd = _mm_add_ps(_mm_loadu_ps(down + i - 1), _mm_loadu_ps(down + i + 1));
+        _mm_storeu_ps(h_down + i, hd);
+        __m128 corner = _mm_add_ps(_mm_loadu_ps(h_up + i), hd);
+        __m128 edge = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(h_mid + i), _mm_loadu_ps(up + i)),
+                                 _mm_loadu_ps(down + i));
+        __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(va, corner), _mm_mul_ps(vb, edge)),
+                              _mm_mul_ps(vc, _mm_loadu_ps(mid + i)));
+        _mm_store_ps(out + i, v);
+    }
+
+    for (; i < array_size - 1; i++) {
+        out[i] = rolled(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static inline float rolled_fma(const float *up, const float *mid, const float *down,
+                               const float *h_up, const float *h_mid, float *h_down,
+                               long i, float a, float b, float c) {
+    float hd = down[i - 1] + down[i + 1];
+    h_down[i] = hd;
+    return fmaf(a, h_up[i] + hd, fmaf(b, h_mid[i] + up[i] + down[i], c * mid[i]));
+}
+
+__attribute__((target("avx2,fma")))
+static void row_avx2(const float *up, const float *mid, const float *down,
+                     const float *h_up, const float *h_mid, float *h_down, float *out,
+                     long array_size, float a, float b, float c) {
+    long i = 1, start = peel_end(out, 8, array_size);
+    for (; i < start; i++) {
+        out[i] = rolled_fma(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+
+    __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b), vc = _mm256_set1_ps(c);
+    for (; i + 8 <= array_size - 1; i += 8) {
+        __m256 hd = _mm256_add_ps(_mm256_loadu_ps(down + i - 1), _mm256_loadu_ps(down + i + 1));
+        _mm256_storeu_ps(h_down + i, hd);
+        __m256 corner = _mm256_add_ps(_mm256_loadu_ps(h_up + i), hd);
+        __m256 edge = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(h_mid + i), _mm256_loadu_ps(up + i)),
+                                    _mm256_loadu_ps(down + i));
+        __m256 v = _mm256_fmadd_ps(va, corner,
+                                   _mm256_fmadd_ps(vb, edge, _mm256_mul_ps(vc, _mm256_loadu_ps(mid + i))));
+        _mm256_store_ps(out + i, v);
+    }
+
+    for (; i < array_size - 1; i++) {
+        out[i] = rolled_fma(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+}
+
+__attribute__((target("avx512f,avx2,fma")))
+static void row_avx512(const float *up, const float *mid, const float *down,
+                       const float *h_up, const float *h_mid, float *h_down, float *out,
+                       long array_size, float a, float b, float c) {
+    long i = 1, start = peel_end(out, 16, array_size);
+    for (; i < start; i++) {
+        out[i] = rolled_fma(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+
+    __m512 va = _mm512_set1_ps(a), vb = _mm512_set1_ps(b), vc = _mm512_set1_ps(c);
+    for (; i + 16 <= array_size - 1; i += 16) {
+        __m512 hd = _mm512_add_ps(_mm512_loadu_ps(down + i - 1), _mm512_loadu_ps(down + i + 1));
+        _mm512_storeu_ps(h_down + i, hd);
+        __m512 corner = _mm512_add_ps(_mm512_loadu_ps(h_up + i), hd);
+        __m512 edge = _mm512_add_ps(_mm512_add_ps(_mm512_loadu_ps(h_mid + i), _mm512_loadu_ps(up + i)),
+                                    _mm512_loadu_ps(down + i));
+        __m512 v = _mm512_fmadd_ps(va, corner,
+                                   _mm512_fmadd_ps(vb, edge, _mm512_mul_ps(vc, _mm512_loadu_ps(mid + i))));
+        _mm512_store_ps(out + i, v);
+    }
+
+    for (; i < array_size - 1; i++) {
+        out[i] = rolled_fma(up, mid, down, h_up, h_mid, h_down, i, a, b, c);
+    }
+}
+
+// Row-band driver shared by all variants.  The three pair-sum rows of every
+// thread are allocated before the parallel region; if that fails the grid
+// is smoothed by smooth(), which needs no scratch, after a warning.
+static void smooth_rows(row_fn row, float *array, float *out_array, long array_size,
+                        float a, float b, float c) {
+    if (array_size < 3) {
+        return;
+    }
+
+    int nthreads = omp_get_max_threads();
+    size_t row_bytes = (array_size * sizeof(float) + ROW_ALIGN - 1) & ~(size_t) (ROW_ALIGN - 1);
+    size_t row_floats = row_bytes / sizeof(float);
+    float *rows = (float *) aligned_alloc(ROW_ALIGN, 3 * nthreads * row_bytes);
+    if (rows == NULL) {
+        fprintf(stderr, "smooth: no memory for %d x 3 row buffers, using the baseline kernel\n", nthreads);
+        smooth(array, out_array, array_size, a, b, c);
+        return;
+    }
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int nt = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        long inner = array_size - 2;
+        long j0 = 1 + inner * tid / nt;
+        long j1 = 1 + inner * (tid + 1) / nt;
+
+        float *h[3];
+        for (int k = 0; k < 3; k++) {
+            h[k] = rows + (3 * tid + k) * row_floats;
+        }
+
+        if (j0 < j1) {
+            pair_sums(array + (j0 - 1) * array_size, h[0], array_size);
+            pair_sums(array + j0 * array_size, h[1], array_size);
+        }
+
+        for (long j = j0; j < j1; j++) {
+            row(array + (j - 1) * array_size, array + j * array_size, array + (j + 1) * array_size,
+                h[0], h[1], h[2], out_array + j * array_size, array_size, a, b, c);
+            float *t = h[0]; h[0] = h[1]; h[1] = h[2]; h[2] = t;
+        }
+    }
+
+    free(rows);
+}
+
+static void smooth_scalar(float *x, float *y, long n, float a, float b, float c) {
+    smooth_rows(row_scalar, x, y, n, a, b, c);
+}
+
+static void smooth_sse(float *x, float *y, long n, float a, float b, float c) {
+    smooth_rows(row_sse, x, y, n, a, b, c);
+}
+
+static void smooth_avx2(float *x, float *y, long n, float a, float b, float c) {
+    smooth_rows(row_avx2, x, y, n, a, b, c);
+}
+
+static void smooth_avx512(float *x, float *y, long n, float a, float b, float c) {
+    smooth_rows(row_avx512, x, y, n, a, b, c);
+}
+
+static int has_any(void)    { return 1; }
+static int has_sse(void)    { return __builtin_cpu_supports("sse2"); }
+static int has_avx2(void)   { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"); }
+static int has_avx512(void) { return __builtin_cpu_supports("avx512f"); }
+
+// Best first; "auto" takes the first entry whose ISA the CPU reports
+static const smooth_kernel_t kernels[] = {
+    { "avx512",   smooth_avx512,   has_avx512 },
+    { "avx2",     smooth_avx2,     has_avx2 },
+    { "sse",      smooth_sse,      has_sse },
+    { "scalar",   smooth_scalar,   has_any },
+    { "baseline", smooth,          has_any },
+    { "stencil9", smooth_stencil9, has_any },
+};
+
+// k-th entry of the table whether or not the CPU supports it, NULL past the end
+const smooth_kernel_t *smooth_kernel_get(int k) {
+    int n = sizeof(kernels) / sizeof(kernels[0]);
+    return k >= 0 && k < n ? &kernels[k] : NULL;
+}
+
+const smooth_kernel_t *smooth_kernel_select(const char *name) {
+    int n = sizeof(kernels) / sizeof(kernels[0]);
+
+    __builtin_cpu_init();
+    for (int k = 0; k < n; k++) {
+        if (name == NULL || strcmp(name, "auto") == 0) {
+            if (kernels[k].supported()) {
+                return &kernels[k];
+            }
+        } else if (strcmp(name, kernels[k].name) == 0) {
+            return kernels[k].supported() ? &kernels[k] : NULL;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,100 @@
+// Generic symmetric stencils, specialised at compile time through stencil_tmpl.h
+//
+// Each shape groups its taps by symmetry class and has one weight per
+// group, listed outermost first.  The 9-point shape lists its taps in the
+// order smooth() adds them, so with weights {a, b, c} it reproduces smooth()
+// bit for bit.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "grid.h"
+
+// 5-point cross: {edge, centre}
+#define STENCIL_NAME    stencil_5pt
+#define STENCIL_RADIUS  1
+#define STENCIL_NGROUPS 2
+#define STENCIL_EXPR(W, P) \
+    W(0) * (P(-1, 0) + P(1, 0) + P(0, -1) + P(0, 1)) + \
+    W(1) * P(0, 0)
+#include "stencil_tmpl.h"
+
+// 9-point box, smooth()'s order: {corner, edge, centre}
+#define STENCIL_NAME    stencil_9pt
+#define STENCIL_RADIUS  1
+#define STENCIL_NGROUPS 3
+#define STENCIL_EXPR(W, P) \
+    W(0) * (P(-1, -1) + P(-1, 1) + P(1, -1) + P(1, 1)) + \
+    W(1) * (P(-1, 0) + P(1, 0) + P(0, -1) + P(0, 1)) + \
+    W(2) * P(0, 0)
+#include "stencil_tmpl.h"
+
+// 13-point diamond (|di| + |dj| <= 2): {axis 2, corner, edge, centre}
+#define STENCIL_NAME    stencil_13pt
+#define STENCIL_RADIUS  2
+#define STENCIL_NGROUPS 4
+#define STENCIL_EXPR(W, P) \
+    W(0) * (P(-2, 0) + P(2, 0) + P(0, -2) + P(0, 2)) + \
+    W(1) * (P(-1, -1) + P(-1, 1) + P(1, -1) + P(1, 1)) + \
+    W(2) * (P(-1, 0) + P(1, 0) + P(0, -1) + P(0, 1)) + \
+    W(3) * P(0, 0)
+#include "stencil_tmpl.h"
+
+// 5x5 box: {corner 2, knight, axis 2, corner, edge, centre}
+#define STENCIL_NAME    stencil_25pt
+#define STENCIL_RADIUS  2
+#define STENCIL_NGROUPS 6
+#define STENCIL_EXPR(W, P) \
+    W(0) * (P(-2, -2) + P(-2, 2) + P(2, -2) + P(2, 2)) + \
+    W(1) * (P(-2, -1) + P(-2, 1) + P(2, -1) + P(2, 1) + \
+            P(-1, -2) + P(-1, 2) + P(1, -2) + P(1, 2)) + \
+    W(2) * (P(-2, 0) + P(2, 0) + P(0, -2) + P(0, 2)) + \
+    W(3) * (P(-1, -1) + P(-1, 1) + P(1, -1) + P(1, 1)) + \
+    W(4) * (P(-1, 0) + P(1, 0) + P(0, -1) + P(0, 1)) + \
+    W(5) * P(0, 0)
+#include "stencil_tmpl.h"
+
+static const stencil_t stencils[] = {
+    { "5pt",   5, 1, 2, stencil_5pt },
+    { "9pt",   9, 1, 3, stencil_9pt },
+    { "13pt", 13, 2, 4, stencil_13pt },
+    { "25pt", 25, 2, 6, stencil_25pt },
+};
+
+const stencil_t *stencil_get(int k) {
+    int n = sizeof(stencils) / sizeof(stencils[0]);
+    return k >= 0 && k < n ? &stencils[k] : NULL;
+}
+
+const stencil_t *stencil_find(const char *name) {
+    const stencil_t *s;
+    for (int k = 0; (s = stencil_get(k)) != NULL; k++) {
+        if (strcmp(name, s->name) == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// Copy the outer `radius` rings of array into out_array, as copy_border()
+// does for radius 1
+void stencil_copy_border(float *array, float *out_array, long array_size, int radius) {
+    memcpy(out_array, array, radius * array_size * sizeof(float));
+    memcpy(out_array + (array_size - radius) * array_size,
+           array + (array_size - radius) * array_size, radius * array_size * sizeof(float));
+
+    #pragma omp parallel for schedule(static)
+        for (long j = radius; j < array_size - radius; j++) {
+            for (int r = 0; r < radius; r++) {
+                out_array[r + j * array_size] = array[r + j * array_size];
+                out_array[array_size - 1 - r + j * array_size] = array[array_size - 1 - r + j * array_size];
+            }
+        }
+}
+
+// smooth()-compatible entry for the kernel table
+void smooth_stencil9(float *array, float *out_array, long array_size, float a, float b, float c) {
+    const float w[3] = { a, b, c };
+    stencil_9pt(array, out_array, array_size, w);
+}
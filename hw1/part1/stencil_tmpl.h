@@ -0,0 +1,41 @@
+// Stencil "template": included once per shape by stencil.c
+//
+// Before each inclusion define
+//   STENCIL_NAME          name of the generated function
+//   STENCIL_RADIUS        largest |offset| of any tap
+//   STENCIL_NGROUPS       number of weights
+//   STENCIL_EXPR(W, P)    the stencil as an expression of W(k), the weight of
+//                         group k, and P(di, dj), the input at column offset
+//                         di and row offset dj
+// The expression is pasted into the loop body verbatim, so offsets and tap
+// counts are compile-time constants and the summation order is exactly the
+// one written in the shape.  The generated function is
+//   static void STENCIL_NAME(const float *x, float *y, long n, const float *w)
+// and writes the cells at least STENCIL_RADIUS away from the edge.
+// No include guard: every inclusion instantiates a new kernel.
+
+static void STENCIL_NAME(const float *restrict array, float *restrict out_array, long array_size,
+                         const float *weights) {
+    float w[STENCIL_NGROUPS];
+    memcpy(w, weights, sizeof(w));
+
+    #pragma omp parallel for schedule(static)
+        for (long j = STENCIL_RADIUS; j < array_size - STENCIL_RADIUS; j++) {
+            const float *row = array + j * array_size;
+            float *out_row = out_array + j * array_size;
+
+            #pragma omp simd
+            for (long i = STENCIL_RADIUS; i < array_size - STENCIL_RADIUS; i++) {
+#define W(k) w[k]
+#define P(di, dj) row[i + (di) + (dj) * array_size]
+                out_row[i] = STENCIL_EXPR(W, P);
+#undef W
+#undef P
+            }
+        }
+}
+
+#undef STENCIL_NAME
+#undef STENCIL_RADIUS
+#undef STENCIL_NGROUPS
+#undef STENCIL_EXPR
@@ -1,5 +1,44 @@
+// Thread placement: CPU topology from sysfs, placement policies, pinning
+//
+// c_setaffinity / f90_setaffinity_ bind the calling thread to one CPU.  On
+// top of them, place_init() reads for every online CPU its package, core,
+// SMT rank, L3 domain and NUMA node from /sys/devices/system/cpu and orders
+// the CPUs by a policy; thread t of a team is then bound to order[t mod
+// ncpus].  Policies (RB_PLACE in the environment, default compact):
+//   compact   fill a core's SMT siblings, then the next core, L3, node
+//   scatter   round-robin over L3 domains, one core at a time, siblings last
+//   core      one thread per physical core first, siblings only after that
+//   numa      round-robin over NUMA nodes, siblings last
+//   none      do not pin; leave it to OMP_PROC_BIND and the scheduler
+// Only CPUs in the process's affinity mask at place_init() are used, so a
+// taskset, numactl --physcpubind or srun --cpu-bind restriction is kept and
+// ranks sharing a node stay on their own CPUs.
+// place_omp() pins every thread of the next OpenMP team and prints the
+// thread -> CPU map to stderr, with a warning if pinning failed;
+// f90_place_omp_ is the Fortran entry point.
+// team.c pins its workers with place_pin().  An unknown RB_PLACE is
+// reported once and leaves every thread unpinned.
+#include <ctype.h>
+#include <dirent.h>
+#include <sched.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <spawn.h>
+#include <omp.h>
+
+#define PLACE_MAX_CPUS 1024
+
+typedef struct {
+    int cpu, package, core, smt, l3, node;
+    int core_in_l3, core_in_node;       // rank of the core inside its L3 domain / node
+} place_cpu_t;
+
+static place_cpu_t place_cpus[PLACE_MAX_CPUS];
+static int place_ncpus;
+static int place_policy = -1;           // -1: place_init() not run yet
+static const char *place_names[] = { "none", "compact", "scatter", "core", "numa" };
+enum { PLACE_NONE, PLACE_COMPACT, PLACE_SCATTER, PLACE_CORE, PLACE_NUMA };
 
 int f90_setaffinity_( int *icore){
     cpu_set_t        mask;
@@ -15,3 +54,232 @@ int c_setaffinity( int icore){
     CPU_SET(icore, &mask);
     return( sched_setaffinity( (pid_t) 0 , sizeof(mask), &mask ) );
 }
+
+// First integer in a sysfs file ("3" or a cpu list "2-3,10-11"); fallback if unreadable
+static int sys_int(int cpu, const char *leaf, int fallback) {
+    char path[256];
+    int value = fallback;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, leaf);
+    FILE *f = fopen(path, "r");
+    if (f != NULL) {
+        if (fscanf(f, "%d", &value) != 1) {
+            value = fallback;
+        }
+        fclose(f);
+    }
+    return value;
+}
+
+// NUMA node: the nodeN entry in the cpu's sysfs directory
+static int sys_node(int cpu) {
+    char path[256];
+    struct dirent *e;
+    int node = 0;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *d = opendir(path);
+    if (d == NULL) {
+        return 0;
+    }
+    while ((e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, "node", 4) == 0 && isdigit((unsigned char) e->d_name[4])) {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    }
+    closedir(d);
+    return node;
+}
+
+// Online CPUs from the "0-3,8-11" list
+static int sys_online(int *cpus) {
+    int n = 0, lo, hi;
+    char c;
+
+    FILE *f = fopen("/sys/devices/system/cpu/online", "r");
+    if (f == NULL) {
+        return 0;
+    }
+    while (n < PLACE_MAX_CPUS && fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        if ((c = fgetc(f)) == '-') {
+            if (fscanf(f, "%d", &hi) != 1) {
+                hi = lo;
+            }
+            c = fgetc(f);
+        }
+        for (; lo <= hi && n < PLACE_MAX_CPUS; lo++) {
+            cpus[n++] = lo;
+        }
+        if (c != ',') {
+            break;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static int place_cmp(const void *p, const void *q) {
+    const place_cpu_t *a = (const place_cpu_t *) p, *b = (const place_cpu_t *) q;
+    int ka[5], kb[5], k;
+
+    switch (place_policy) {
+    case PLACE_SCATTER:
+        ka[0] = a->smt; ka[1] = a->core_in_l3;   ka[2] = a->l3;      ka[3] = a->node; ka[4] = a->cpu;
+        kb[0] = b->smt; kb[1] = b->core_in_l3;   kb[2] = b->l3;      kb[3] = b->node; kb[4] = b->cpu;
+        break;
+    case PLACE_NUMA:
+        ka[0] = a->smt; ka[1] = a->core_in_node; ka[2] = a->node;    ka[3] = a->l3;   ka[4] = a->cpu;
+        kb[0] = b->smt; kb[1] = b->core_in_node; kb[2] = b->node;    kb[3] = b->l3;   kb[4] = b->cpu;
+        break;
+    case PLACE_CORE:
+        ka[0] = a->smt; ka[1] = a->node; ka[2] = a->package; ka[3] = a->l3; ka[4] = a->core;
+        kb[0] = b->smt; kb[1] = b->node; kb[2] = b->package; kb[3] = b->l3; kb[4] = b->core;
+        break;
+    default:                            // compact
+        ka[0] = a->node; ka[1] = a->package; ka[2] = a->l3; ka[3] = a->core; ka[4] = a->smt;
+        kb[0] = b->node; kb[1] = b->package; kb[2] = b->l3; kb[3] = b->core; kb[4] = b->smt;
+        break;
+    }
+    for (k = 0; k < 5; k++) {
+        if (ka[k] != kb[k]) {
+            return ka[k] < kb[k] ? -1 : 1;
+        }
+    }
+    return a->cpu - b->cpu;
+}
+
+// Read the topology and order the CPUs for policy (NULL: $RB_PLACE, else compact).
+// Returns 0, or -1 for an unknown policy name.
+int place_init(const char *policy) {
+    int online[PLACE_MAX_CPUS];
+    int i, j, k;
+
+    if (policy == NULL) {
+        policy = getenv("RB_PLACE") != NULL ? getenv("RB_PLACE") : "compact";
+    }
+    for (k = 0; k < 5 && strcmp(policy, place_names[k]) != 0; k++) {
+    }
+    if (k == 5) {
+        return -1;
+    }
+    place_policy = k;
+
+    // Online CPUs that the process may run on
+    cpu_set_t allowed;
+    int nonline = sys_online(online);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (i = j = 0; i < nonline; i++) {
+            if (online[i] < CPU_SETSIZE && CPU_ISSET(online[i], &allowed)) {
+                online[j++] = online[i];
+            }
+        }
+        nonline = j;
+    }
+    place_ncpus = nonline;
+    if (place_ncpus == 0) {
+        place_ncpus = 1;
+        online[0] = sched_getcpu() >= 0 ? sched_getcpu() : 0;
+    }
+    for (i = 0; i < place_ncpus; i++) {
+        place_cpu_t *p = &place_cpus[i];
+        p->cpu = online[i];
+        p->package = sys_int(p->cpu, "topology/physical_package_id", 0);
+        p->core = sys_int(p->cpu, "topology/core_id", p->cpu);
+        p->l3 = sys_int(p->cpu, "cache/index3/shared_cpu_list", p->package);
+        p->node = sys_node(p->cpu);
+    }
+
+    // SMT rank: siblings are the CPUs with the same package and core id
+    for (i = 0; i < place_ncpus; i++) {
+        place_cpu_t *p = &place_cpus[i];
+        p->smt = 0;
+        for (j = 0; j < i; j++) {
+            p->smt += place_cpus[j].package == p->package && place_cpus[j].core == p->core;
+        }
+    }
+
+    // Rank of each core inside its L3 domain and its node, counted on first siblings
+    for (i = 0; i < place_ncpus; i++) {
+        place_cpu_t *p = &place_cpus[i];
+        p->core_in_l3 = p->core_in_node = 0;
+        for (j = 0; j < place_ncpus; j++) {
+            place_cpu_t *q = &place_cpus[j];
+            if (q->smt != 0 || (q->package == p->package && q->core == p->core)) {
+                continue;
+            }
+            int before = q->package < p->package || (q->package == p->package && q->core < p->core);
+            p->core_in_l3 += before && q->l3 == p->l3;
+            p->core_in_node += before && q->node == p->node;
+        }
+    }
+
+    qsort(place_cpus, place_ncpus, sizeof(place_cpu_t), place_cmp);
+    return 0;
+}
+
+const char *place_policy_name(void) {
+    return place_policy < 0 ? "unset" : place_names[place_policy];
+}
+
+// CPU for thread t of a team, -1 (do not pin) for policy none or a bad RB_PLACE
+int place_cpu(int t) {
+    if (place_policy < 0 && place_init(NULL) != 0) {
+        fprintf(stderr, "RB_PLACE must be none, compact, scatter, core or numa; not pinning\n");
+        place_policy = PLACE_NONE;
+    }
+    return place_policy == PLACE_NONE || place_ncpus == 0 ? -1 : place_cpus[t % place_ncpus].cpu;
+}
+
+// Bind the calling thread as thread t
+int place_pin(int t) {
+    int cpu = place_cpu(t);
+    return cpu < 0 ? 0 : c_setaffinity(cpu);
+}
+
+// Print the thread -> CPU map; cpus[t] is where thread t runs
+void place_report(const int *cpus, int nthreads) {
+    int t, i;
+
+    fprintf(stderr, "placement %s, %d threads on %d cpus:", place_policy_name(), nthreads, place_ncpus);
+    for (t = 0; t < nthreads; t++) {
+        for (i = 0; i < place_ncpus && place_cpus[i].cpu != cpus[t]; i++) {
+        }
+        if (i < place_ncpus) {
+            fprintf(stderr, " %d->%d(s%d c%d t%d n%d)", t, cpus[t], place_cpus[i].package,
+                    place_cpus[i].core, place_cpus[i].smt, place_cpus[i].node);
+        } else {
+            fprintf(stderr, " %d->%d", t, cpus[t]);
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+// Pin every thread of an OpenMP team of the current size and print the map
+int place_omp(void) {
+    int cpus[PLACE_MAX_CPUS];
+    int nthreads = 1, err = 0;
+
+    place_cpu(0);                       // read the topology once, outside the team
+
+    #pragma omp parallel reduction(|:err)
+    {
+        int t = omp_get_thread_num();
+        #pragma omp single
+        nthreads = omp_get_num_threads();
+        err |= place_pin(t) != 0;
+        if (t < PLACE_MAX_CPUS) {
+            cpus[t] = sched_getcpu();
+        }
+    }
+    place_report(cpus, nthreads < PLACE_MAX_CPUS ? nthreads : PLACE_MAX_CPUS);
+    if (err) {
+        fprintf(stderr, "placement: some threads could not be pinned, they run unbound\n");
+    }
+    return err ? -1 : 0;
+}
+
+int f90_place_omp_(void) {
+    return place_omp();
+}
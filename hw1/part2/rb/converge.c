@@ -0,0 +1,175 @@
+// Convergence policies for the red/black iteration: fewer error reductions
+//
+// prb_a reduces the error after every iteration, a full pass over a[] that
+// costs about as much as the sweep itself.  rb_converge() runs the same
+// iteration to the first iteration whose error is < tol, with one of
+//   RB_DENSE        check every iteration (prb_a)
+//   RB_EVERY        check every k iterations; k is half the number of
+//                   iterations the observed decay rate predicts are left,
+//                   so checks get denser as the error approaches tol
+//   RB_EXTRAPOLATE  jump straight to one iteration before the predicted
+//                   convergence, then check every iteration
+//   RB_FUSED        every iteration is rb_fused_sweep(), whose error comes
+//                   out of the update pass, so no reduction pass at all
+// Skipping checks can step past the first converged iteration.  The first
+// sweep of a jump of more than one iteration reads a[] and writes the
+// second buffer, which leaves a[] untouched as a checkpoint without a copy
+// pass (as rb_wave.c does); the buffers swap after each jump.  If the check
+// after the jump is already below tol, the jump is replayed from the
+// checkpoint one checked iteration at a time.  That finds the first
+// converged iteration as long as the error decreases monotonically, which
+// it does for this averaging iteration.  The second buffer is the caller's
+// work array (or one allocated here); if the result ends up there it is
+// copied back to a[], once.
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "converge.h"
+
+double rb_fused_sweep(double *, int);   // rb_fused.c
+
+static void rb_sweep(double *a, int n) {
+    int i;
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(runtime)
+            for (i = 1; i < n; i += 2) {
+                a[i] = (a[i] + a[i-1]) / 2.0;
+            }
+
+        #pragma omp for schedule(runtime)
+            for (i = 0; i < n-1; i += 2) {
+                a[i] = (a[i] + a[i+1]) / 2.0;
+            }
+    }
+}
+
+// One sweep from a[] into b[]; bit for bit rb_sweep()
+static void rb_sweep_to(const double *a, double *b, int n) {
+    int k;
+    #pragma omp parallel for schedule(runtime)
+        for (k = 0; k < n / 2; k++) {
+            b[2*k+1] = (a[2*k+1] + a[2*k]) / 2.0;
+            b[2*k] = (a[2*k] + b[2*k+1]) / 2.0;
+        }
+    if (n % 2 == 1) {
+        b[n-1] = a[n-1];
+    }
+}
+
+static double rb_error(const double *a, int n, rb_policy_t *p) {
+    int i;
+    double error = 0.0;
+    #pragma omp parallel for schedule(runtime) reduction(+:error)
+        for (i = 0; i < n-1; i++) {
+            error = error + fabs(a[i] - a[i+1]);
+        }
+    p->reductions++;
+    return error;
+}
+
+int rb_policy_parse(const char *name) {
+    static const char *names[] = { "dense", "every", "extrapolate", "fused" };
+    int k;
+    for (k = 0; k < 4; k++) {
+        if (strcmp(name, names[k]) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+// Iterations still needed to get from e1 (at iteration t1) below tol, at the
+// decay rate seen since e0 (at t0); -1 if the error is not decaying
+int rb_converge_predict(double e0, int t0, double e1, int t1, double tol) {
+    if (t1 <= t0 || e1 <= 0.0 || e1 >= e0) {
+        return -1;
+    }
+    if (e1 < tol) {
+        return 0;
+    }
+    double rate = pow(e1 / e0, 1.0 / (t1 - t0));
+    return (int) ceil(log(tol / e1) / log(rate));
+}
+
+// work: a second array of n doubles, best first touched by the caller's
+// threads; NULL allocates one, and if that fails every iteration is checked
+int rb_converge(double *a, double *work, int n, double tol, rb_policy_t *p) {
+    double e0 = 0.0, e1 = 0.0, error;
+    int t0 = -1, t1 = -1, it = 0, s;
+    double *cur = a, *next = work, *own = NULL, *swap;
+
+    p->reductions = p->checkpoints = p->replayed = p->copyback = 0;
+
+    if (p->mode == RB_FUSED) {
+        do {
+            error = rb_fused_sweep(a, n);
+            it++;
+        } while (error >= tol);
+        p->error = error;
+        return it;
+    }
+
+    if (next == NULL && p->mode != RB_DENSE) {
+        next = own = (double *) malloc(n * sizeof(double));
+    }
+
+    for (;;) {
+        int step = 1;
+        if (p->mode != RB_DENSE && next != NULL && t0 >= 0) {
+            int left = rb_converge_predict(e0, t0, e1, t1, tol);
+            if (left > 1) {
+                step = p->mode == RB_EVERY ? left / 2 : left - 1;
+            }
+        }
+
+        if (step == 1) {
+            rb_sweep(cur, n);
+            error = rb_error(cur, n, p);
+        } else {
+            // Jump out of place: cur is the checkpoint
+            rb_sweep_to(cur, next, n);
+            for (s = 1; s < step; s++) {
+                rb_sweep(next, n);
+            }
+            p->checkpoints++;
+            error = rb_error(next, n, p);
+
+            if (error < tol) {
+                // Stepped past the first converged iteration: replay checked
+                for (s = 1; ; s++) {
+                    rb_sweep(cur, n);
+                    p->replayed++;
+                    error = rb_error(cur, n, p);
+                    if (error < tol || s == step) {
+                        break;
+                    }
+                }
+                it += s;
+                break;
+            }
+            swap = cur;
+            cur = next;
+            next = swap;
+        }
+
+        it += step;
+        if (error < tol) {
+            break;
+        }
+        e0 = e1;
+        t0 = t1;
+        e1 = error;
+        t1 = it;
+    }
+
+    if (cur != a) {
+        memcpy(a, cur, n * sizeof(double));
+        p->copyback = 1;
+    }
+    free(own);
+    p->error = error;
+    return it;
+}
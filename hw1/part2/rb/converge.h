@@ -0,0 +1,20 @@
+// converge.c: convergence policies for the red/black iteration
+#ifndef CONVERGE_H
+#define CONVERGE_H
+
+enum { RB_DENSE, RB_EVERY, RB_EXTRAPOLATE, RB_FUSED };
+
+typedef struct {
+    int mode;                   // RB_DENSE ... RB_FUSED
+    int reductions;             // error passes run
+    int checkpoints;            // jumps run out of place from a checkpoint
+    int replayed;               // sweeps redone after stepping past convergence
+    int copyback;               // 1 if the result was copied back from the work array
+    double error;               // error at the returned iteration
+} rb_policy_t;
+
+int rb_policy_parse(const char *);
+int rb_converge_predict(double, int, double, int, double);
+int rb_converge(double *, double *, int, double, rb_policy_t *);
+
+#endif
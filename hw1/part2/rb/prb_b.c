@@ -6,6 +6,7 @@
 
 double gtod_timer(void);    // timer prototype
 int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
 
 int main() {
 
@@ -23,6 +24,7 @@ int main() {
         }
     }
     #endif
+    place_omp();
 
     #pragma omp parallel for
         for(i = 0; i < N-1; i+=2) {
@@ -6,6 +6,7 @@
 
 double gtod_timer(void);    // timer prototype
 int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
 
 int main() {
 
@@ -23,6 +24,7 @@ int main() {
         }
     }
     #endif
+    place_omp();
 
     #pragma omp parallel 
     {
@@ -38,12 +40,9 @@ int main() {
         do {
             
                 #pragma omp for schedule(runtime)
-                    for (i = 0; i < N; i += 2) {
-                        if (i % 2 == 0) {
-                            a[i] = (a[i] + a[i+1]) / 2.0;
-                        } else {
-                            a[i] = (a[i] + a[i-1]) / 2.0;
-                        }
+                    for (i = 0; i < N-1; i += 2) {
+                        a[i+1] = (a[i+1] + a[i]) / 2.0;
+                        a[i] = (a[i] + a[i+1]) / 2.0;
                     }
 
                 #pragma omp single 
@@ -63,5 +62,5 @@ int main() {
     t1 = gtod_timer();
     time  = t1 - t0;
 
-    printf("%lf\n",time);
+    printf("%lf %d\n",time,niter);
 }
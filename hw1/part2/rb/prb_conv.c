@@ -0,0 +1,70 @@
+// Red-black relaxation under each convergence policy of converge.c
+//
+// usage: a.out_prb_conv [dense|every|extrapolate|fused ...]
+// Runs prb_a's iteration to error < 1.0 once per policy (all four by
+// default) and reports the iteration it stopped at, which must be the same
+// for every policy, and how many passes over a[] it saved against checking
+// every iteration: the reductions skipped, less two for a copy back (a copy
+// reads and writes a[]).
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include "converge.h"
+
+#define N 30000000
+
+double gtod_timer(void);    // timer prototype
+int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
+
+int main(int argc, char *argv[]) {
+
+    static const char *all[] = { "dense", "every", "extrapolate", "fused" };
+    const char **names = argc > 1 ? (const char **) argv + 1 : all;
+    int npolicies = argc > 1 ? argc - 1 : 4;
+    int i, k, nt=1, niter=0;
+    static double a[N], work[N];
+    rb_policy_t policy;
+
+    double time, t0, t1;
+
+    #ifdef _OPENMP
+    #pragma omp parallel private(nt)
+    {
+        nt = omp_get_num_threads();
+        if(nt<1) {
+            printf("NO print, OMP warmup.\n");
+        }
+    }
+    #endif
+    place_omp();
+
+    printf("%-12s %6s %10s %12s %10s %6s %11s %8s %8s\n", "policy", "iters", "time (s)", "error",
+           "reductions", "saved", "checkpoints", "replayed", "copyback");
+
+    for (k = 0; k < npolicies; k++) {
+        policy.mode = rb_policy_parse(names[k]);
+        if (policy.mode < 0) {
+            printf("Unknown policy %s\n", names[k]);
+            exit(1);
+        }
+
+        #pragma omp parallel for
+            for(i = 0; i < N-1; i+=2) {
+                a[i] = 0.0;
+                a[i+1] = 1.0;
+                work[i] = work[i+1] = 0.0;
+            }
+
+        t0 = gtod_timer();
+        niter = rb_converge(a, work, N, 1.0, &policy);
+        t1 = gtod_timer();
+        time  = t1 - t0;
+
+        printf("%-12s %6d %10.4f %12.6e %10d %6d %11d %8d %8d\n", names[k], niter, time, policy.error,
+               policy.reductions, niter - policy.reductions - 2 * policy.copyback,
+               policy.checkpoints, policy.replayed, policy.copyback);
+    }
+}
@@ -0,0 +1,49 @@
+#include <math.h>
+#include <stdio.h>
+#include <omp.h>
+
+#define N 30000000
+
+double gtod_timer(void);            // timer prototype
+int c_setaffinity(int);             // affinity prototype
+int place_omp(void);                // placement prototype
+double rb_fused_sweep(double *, int);   // fused red/black + error prototype (rb_fused.c)
+
+int main() {
+
+    int i, nt=1, niter=0;
+    static double a[N];
+    double error=0.0;
+
+    double time, t0, t1;
+
+    #ifdef _OPENMP
+    #pragma omp parallel private(nt)
+    {
+        nt = omp_get_num_threads();
+        if(nt<1) {
+            printf("NO print, OMP warmup.\n");
+        }
+    }
+    #endif
+    place_omp();
+
+    #pragma omp parallel for
+        for(i = 0; i < N-1; i+=2) {
+            a[i] = 0.0;
+            a[i+1] = 1.0;
+        }
+
+    t0 = gtod_timer();
+
+    // One pass per iteration: both colours and the error together
+    do {
+        error = rb_fused_sweep(a, N);
+        niter++;
+    } while (error >= 1.0);
+
+    t1 = gtod_timer();
+    time  = t1 - t0;
+
+    printf("%lf %d\n",time,niter);
+}
@@ -0,0 +1,136 @@
+// Red-black relaxation accelerated by a two-level multigrid cycle
+//
+// The red-black sweep of prb_a couples a[2k] and a[2k+1] only:
+//     a[2k+1] = (a[2k] + a[2k+1]) / 2,  a[2k] = (a[2k] + a[2k+1]) / 2
+// so every pair is a separate 2x2 problem.  The sweep leaves the weighted
+// pair mean  u_k = (2 a[2k] + a[2k+1]) / 3  unchanged and shrinks the pair
+// difference by 4x, so each pair converges to a[2k] = a[2k+1] = u_k.
+//
+// One cycle is
+//   NU1 red-black sweeps (the prb_a smoother),
+//   restriction    u_k = (2 a[2k] + a[2k+1]) / 3   (N/2 coarse points),
+//   coarse solve   the sweep is the identity on u, so u is already solved,
+//   prolongation   a[2k] = a[2k+1] = u_k,
+//   NU2 red-black sweeps,
+// then the error of prb_a.  Because the coarse level has no coupling
+// between points there is no third level to recurse into.  All levels are
+// OpenMP parallel for loops.  The fixed point reached is the one prb_a's
+// loop converges to; it is run first for reference.
+#include <math.h>
+#include <stdio.h>
+#include <omp.h>
+
+#define N   30000000
+#define NU1 1
+#define NU2 1
+
+double gtod_timer(void);    // timer prototype
+int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
+
+static double a[N], u[N / 2];
+
+static void rb_init(double *a) {
+    int i;
+    #pragma omp parallel for
+        for (i = 0; i < N-1; i += 2) {
+            a[i] = 0.0;
+            a[i+1] = 1.0;
+        }
+}
+
+// The prb_a smoother: red points, then black points
+static void rb_sweep(double *a) {
+    int i;
+    #pragma omp parallel for schedule(runtime)
+        for (i = 1; i < N; i += 2) {
+            a[i] = (a[i] + a[i-1]) / 2.0;
+        }
+
+    #pragma omp parallel for schedule(runtime)
+        for (i = 0; i < N-1; i += 2) {
+            a[i] = (a[i] + a[i+1]) / 2.0;
+        }
+}
+
+static double rb_error(const double *a) {
+    int i;
+    double error = 0.0;
+    #pragma omp parallel for schedule(runtime) reduction(+:error)
+        for (i = 0; i < N-1; i++) {
+            error = error + fabs(a[i] - a[i+1]);
+        }
+    return error;
+}
+
+// Fine -> coarse: the pair mean the sweep conserves
+static void rb_restrict(const double *a, double *u) {
+    int k;
+    #pragma omp parallel for schedule(runtime)
+        for (k = 0; k < N / 2; k++) {
+            u[k] = (2.0 * a[2*k] + a[2*k+1]) / 3.0;
+        }
+}
+
+// Coarse -> fine: the converged pair takes the coarse value at both points
+static void rb_prolong(const double *u, double *a) {
+    int k;
+    #pragma omp parallel for schedule(runtime)
+        for (k = 0; k < N / 2; k++) {
+            a[2*k] = u[k];
+            a[2*k+1] = u[k];
+        }
+}
+
+int main() {
+
+    int s, nt=1, niter=0, ncycle=0;
+    double error=0.0;
+
+    double time, t0, t1;
+
+    #ifdef _OPENMP
+    #pragma omp parallel private(nt)
+    {
+        nt = omp_get_num_threads();
+        if(nt<1) {
+            printf("NO print, OMP warmup.\n");
+        }
+    }
+    #endif
+    place_omp();
+
+    // Reference: prb_a's relaxation loop
+    rb_init(a);
+    t0 = gtod_timer();
+    do {
+        rb_sweep(a);
+        error = rb_error(a);
+        niter++;
+    } while (error >= 1.0);
+    t1 = gtod_timer();
+    time  = t1 - t0;
+
+    printf("%-12s %8s %10s %14s\n", "method", "iters", "time (s)", "final error");
+    printf("%-12s %8d %10.4f %14.6e\n", "relaxation", niter, time, error);
+
+    // Multigrid cycles to the same criterion
+    rb_init(a);
+    t0 = gtod_timer();
+    do {
+        for (s = 0; s < NU1; s++) {
+            rb_sweep(a);
+        }
+        rb_restrict(a, u);
+        rb_prolong(u, a);
+        for (s = 0; s < NU2; s++) {
+            rb_sweep(a);
+        }
+        error = rb_error(a);
+        ncycle++;
+    } while (error >= 1.0);
+    t1 = gtod_timer();
+    time  = t1 - t0;
+
+    printf("%-12s %8d %10.4f %14.6e\n", "multigrid", ncycle, time, error);
+}
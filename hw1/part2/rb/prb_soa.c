@@ -0,0 +1,95 @@
+// Benchmark: interleaved a[] (prb_a) against colour-separated red[]/black[]
+//
+// usage: a.out_prb_soa [max_threads]
+// For 1 .. max_threads (default 16) threads, runs prb_a's iteration to
+// error < 1.0 on the interleaved layout and on the SoA layout of rb_soa.c,
+// and checks that both stop at the same iteration with identical arrays.
+// The SoA time excludes the split/merge conversions, which are reported
+// on their own.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#define N 30000000
+
+double gtod_timer(void);    // timer prototype
+int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
+void rb_soa_split(const double *, double *, double *, int);     // rb_soa.c prototypes
+void rb_soa_merge(const double *, const double *, double *, int);
+void rb_soa_sweep(double *, double *, int);
+double rb_soa_error(const double *, const double *, int);
+
+int main(int argc, char *argv[]) {
+
+    int i, nt, niter, niter_soa;
+    int max_threads = argc > 1 ? atoi(argv[1]) : 16;
+    static double a[N], b[N], red[N/2], black[N/2];
+    double error;
+
+    double time, time_soa, time_conv, t0, t1;
+
+    printf("%7s %6s %15s %12s %8s %14s %10s\n", "threads", "iters", "interleaved (s)", "SoA (s)",
+           "speedup", "split+merge (s)", "identical");
+
+    for (nt = 1; nt <= max_threads; nt++) {
+        omp_set_num_threads(nt);
+        place_omp();
+
+        // Interleaved: prb_a
+        #pragma omp parallel for
+            for(i = 0; i < N-1; i+=2) {
+                a[i] = 0.0;
+                a[i+1] = 1.0;
+            }
+        memcpy(b, a, sizeof(a));
+
+        niter = 0;
+        t0 = gtod_timer();
+        do {
+            #pragma omp parallel for schedule(static)
+                for (i = 1; i < N; i += 2) {
+                    a[i] = (a[i] + a[i-1]) / 2.0;
+                }
+
+            #pragma omp parallel for schedule(static)
+                for (i = 0; i < N-1; i += 2) {
+                    a[i] = (a[i] + a[i+1]) / 2.0;
+                }
+
+            error=0.0;
+            niter++;
+
+            #pragma omp parallel for schedule(static) reduction(+:error)
+                for (i = 0; i < N-1; i++) {
+                    error = error + fabs(a[i] - a[i+1]);
+                }
+        } while (error >= 1.0);
+        t1 = gtod_timer();
+        time = t1 - t0;
+
+        // SoA: same iteration on red[]/black[]
+        t0 = gtod_timer();
+        rb_soa_split(b, red, black, N);
+        time_conv = gtod_timer() - t0;
+
+        niter_soa = 0;
+        t0 = gtod_timer();
+        do {
+            rb_soa_sweep(red, black, N);
+            error = rb_soa_error(red, black, N);
+            niter_soa++;
+        } while (error >= 1.0);
+        t1 = gtod_timer();
+        time_soa = t1 - t0;
+
+        t0 = gtod_timer();
+        rb_soa_merge(red, black, b, N);
+        time_conv += gtod_timer() - t0;
+
+        printf("%7d %6d %15.4f %12.4f %8.2f %14.4f %10s\n", nt, niter, time, time_soa, time / time_soa,
+               time_conv, niter == niter_soa && memcmp(a, b, sizeof(a)) == 0 ? "yes" : "NO");
+    }
+}
@@ -0,0 +1,199 @@
+// prb_b's red-black loop on the persistent team (team.c) against OpenMP
+//
+// usage: a.out_prb_team [reps]
+// First times the bare primitives, a barrier and a barrier + sum, over
+// reps calls (default 100000) with OpenMP and with the team, then runs
+// prb_b's iteration to error < 1.0 both ways.  The team is as large as
+// OMP_NUM_THREADS and pinned; both runs must take the same number of
+// iterations and give the same array.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "team.h"
+
+#define N 30000000
+
+double gtod_timer(void);    // timer prototype
+int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
+
+static double a[N], b[N];
+static int reps;
+
+typedef struct {
+    double *a;
+    int niter;
+    double error;
+} rb_team_t;
+
+static void team_barriers(team_t *team, int id, void *arg) {
+    int r;
+    (void) arg;
+    for (r = 0; r < reps; r++) {
+        team_barrier(team, id);
+    }
+}
+
+static void team_sums(team_t *team, int id, void *arg) {
+    int r;
+    double s = 0.0;
+    for (r = 0; r < reps; r++) {
+        s = team_sum(team, id, 1.0);
+    }
+    if (id == 0) {
+        *(double *) arg = s;
+    }
+}
+
+// prb_b's do-while, one member's share; every member sees the same error
+static void team_rb(team_t *team, int id, void *arg) {
+    rb_team_t *rb = (rb_team_t *) arg;
+    double *a = rb->a, error;
+    long lo, hi, i;
+    int niter = 0;
+
+    team_range(team, id, N / 2, &lo, &hi);
+    do {
+        for (i = 2*lo + 1; i < 2*hi; i += 2) {
+            a[i] = (a[i] + a[i-1]) / 2.0;
+        }
+        team_barrier(team, id);
+
+        for (i = 2*lo; i < 2*hi; i += 2) {
+            a[i] = (a[i] + a[i+1]) / 2.0;
+        }
+        team_barrier(team, id);
+
+        error = 0.0;
+        for (i = 2*lo; i < 2*hi && i < N-1; i++) {
+            error = error + fabs(a[i] - a[i+1]);
+        }
+        error = team_sum(team, id, error);
+        niter++;
+    } while (error >= 1.0);
+
+    if (id == 0) {
+        rb->niter = niter;
+        rb->error = error;
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    int i, r, nt=1, niter=0;
+    double error=0.0, s=0.0;
+    rb_team_t rb;
+
+    double time, time_team, t0, t1;
+
+    reps = argc > 1 ? atoi(argv[1]) : 100000;
+
+    #ifdef _OPENMP
+    #pragma omp parallel private(nt)
+    {
+        nt = omp_get_num_threads();
+        if(nt<1) {
+            printf("NO print, OMP warmup.\n");
+        }
+    }
+    #endif
+    place_omp();
+
+    nt = omp_get_max_threads();
+    team_t *team = team_create(nt, 1);
+    if (team == NULL) {
+        printf("Could not start a team of %d threads\n", nt);
+        exit(1);
+    }
+
+    printf("%-45s: %d\n", "Threads (OpenMP and team)", nt);
+    printf("\n%-20s %14s %14s\n", "per call (us)", "OpenMP", "team");
+
+    // Barrier
+    t0 = gtod_timer();
+    #pragma omp parallel private(r)
+    {
+        for (r = 0; r < reps; r++) {
+            #pragma omp barrier
+        }
+    }
+    time = gtod_timer() - t0;
+    t0 = gtod_timer();
+    team_run(team, team_barriers, NULL);
+    time_team = gtod_timer() - t0;
+    printf("%-20s %14.3f %14.3f\n", "barrier", 1e6 * time / reps, 1e6 * time_team / reps);
+
+    // Barrier + sum: the error reduction of prb_b
+    t0 = gtod_timer();
+    #pragma omp parallel private(r)
+    {
+        for (r = 0; r < reps; r++) {
+            #pragma omp single
+            s = 0.0;
+            #pragma omp for schedule(static) reduction(+:s)
+                for (i = 0; i < nt; i++) {
+                    s = s + 1.0;
+                }
+        }
+    }
+    time = gtod_timer() - t0;
+    t0 = gtod_timer();
+    team_run(team, team_sums, &s);
+    time_team = gtod_timer() - t0;
+    printf("%-20s %14.3f %14.3f\n", "barrier + sum", 1e6 * time / reps, 1e6 * time_team / reps);
+
+    // prb_b
+    #pragma omp parallel for
+        for(i = 0; i < N-1; i+=2) {
+            a[i] = 0.0;
+            a[i+1] = 1.0;
+        }
+    memcpy(b, a, sizeof(a));
+
+    t0 = gtod_timer();
+    #pragma omp parallel
+    {
+        do {
+            #pragma omp for schedule(static)
+                for (i = 1; i < N; i += 2) {
+                    a[i] = (a[i] + a[i-1]) / 2.0;
+                }
+
+            #pragma omp for schedule(static)
+                for (i = 0; i < N-1; i += 2) {
+                    a[i] = (a[i] + a[i+1]) / 2.0;
+                }
+
+            #pragma omp single
+            {
+                error=0.0;
+                niter++;
+            }
+
+            #pragma omp for schedule(static) reduction(+:error)
+                for (i = 0; i < N-1; i++) {
+                    error = error + fabs(a[i] - a[i+1]);
+                }
+        } while (error >= 1.0);
+    }
+    t1 = gtod_timer();
+    time = t1 - t0;
+
+    rb.a = b;
+    t0 = gtod_timer();
+    team_run(team, team_rb, &rb);
+    t1 = gtod_timer();
+    time_team = t1 - t0;
+
+    printf("\n%-20s %14s %14s\n", "prb_b loop", "OpenMP", "team");
+    printf("%-20s %14d %14d\n", "iterations", niter, rb.niter);
+    printf("%-20s %14.4f %14.4f\n", "time (s)", time, time_team);
+    printf("%-20s %14.6e %14.6e\n", "error", error, rb.error);
+    printf("%-45s: %s\n", "Same iterations and array",
+           niter == rb.niter && memcmp(a, b, sizeof(a)) == 0 ? "yes" : "NO");
+
+    team_destroy(team);
+}
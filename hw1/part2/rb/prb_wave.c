@@ -0,0 +1,87 @@
+// Pipelined multi-iteration windows (rb_wave.c) against prb_a's loop
+//
+// usage: a.out_prb_wave [wmax] [chunk]
+// wmax is the longest window in iterations (default 8), chunk the pairs a
+// thread takes through a window at a time (default 8192, 256 KB).  Both runs
+// must stop at the same iteration with identical arrays.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "rb_wave.h"
+
+#define N 30000000
+
+double gtod_timer(void);    // timer prototype
+int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
+
+int main(int argc, char *argv[]) {
+
+    int i, nt=1, niter=0, niter_wave;
+    int wmax = argc > 1 ? atoi(argv[1]) : 8;
+    int chunk = argc > 2 ? atoi(argv[2]) : 8192;
+    static double a[N], b[N], work[N];
+    double error=0.0;
+    rb_wave_stats_t st;
+
+    double time, time_wave, t0, t1;
+
+    #ifdef _OPENMP
+    #pragma omp parallel private(nt)
+    {
+        nt = omp_get_num_threads();
+        if(nt<1) {
+            printf("NO print, OMP warmup.\n");
+        }
+    }
+    #endif
+    place_omp();
+
+    #pragma omp parallel for
+        for(i = 0; i < N-1; i+=2) {
+            a[i] = 0.0;
+            a[i+1] = 1.0;
+            work[i] = work[i+1] = 0.0;
+        }
+    memcpy(b, a, sizeof(a));
+
+    t0 = gtod_timer();
+    do {
+        #pragma omp parallel for schedule(runtime)
+            for (i = 1; i < N; i += 2) {
+                a[i] = (a[i] + a[i-1]) / 2.0;
+            }
+
+        #pragma omp parallel for schedule(runtime)
+            for (i = 0; i < N-1; i += 2) {
+                a[i] = (a[i] + a[i+1]) / 2.0;
+            }
+
+        error=0.0;
+        niter++;
+
+        #pragma omp parallel for schedule(runtime) reduction(+:error)
+            for (i = 0; i < N-1; i++) {
+                error = error + fabs(a[i] - a[i+1]);
+            }
+    } while (error >= 1.0);
+    t1 = gtod_timer();
+    time = t1 - t0;
+
+    t0 = gtod_timer();
+    niter_wave = rb_wave_converge(b, work, N, 1.0, wmax, chunk, &st);
+    t1 = gtod_timer();
+    time_wave = t1 - t0;
+
+    printf("%-45s: %d\n", "OMP: Number of threads", omp_get_max_threads());
+    printf("%-45s: %d / %d pairs\n", "Window max / chunk", wmax, chunk);
+    printf("%-45s: %d iters, %.4f s, error %.6e\n", "prb_a loop", niter, time, error);
+    printf("%-45s: %d iters, %.4f s, error %.6e\n", "pipelined windows", niter_wave, time_wave, st.error);
+    printf("%-45s: %d windows, %d rollbacks, %d replayed, %s\n", "Windows",
+           st.windows, st.rollbacks, st.replayed, st.copyback ? "copied back" : "in place");
+    printf("%-45s: %s\n", "Same iteration and array",
+           niter == niter_wave && memcmp(a, b, sizeof(a)) == 0 ? "yes" : "NO");
+}
@@ -6,6 +6,7 @@
 
 double gtod_timer(void);    // timer prototype
 int c_setaffinity(int);     // affinity prototype
+int place_omp(void);        // placement prototype
 
 int main() {
 
@@ -18,6 +19,7 @@ int main() {
 #pragma omp parallel private(nt)
 { nt = omp_get_num_threads(); if(nt<1) printf("NO print, OMP warmup.\n"); }
 #endif
+   place_omp();                                  // pin threads, print the map
 
    for(i = 0; i < N-1; i+=2) {a[i]   = 0.0; a[i+1] = 1.0;}
     
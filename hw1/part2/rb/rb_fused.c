@@ -0,0 +1,79 @@
+// Fused red/black update + error reduction: one pass over a[] per iteration
+//
+// prb_a makes three passes per iteration (red, black, error).  Here each
+// thread walks a contiguous block of pairs (a[2k], a[2k+1]) once: it
+// updates the red point, then the black point, and adds the two error
+// terms that are known at that moment,
+//     |a[2k] - a[2k+1]|          inside the pair, and
+//     |a[2k-1] - a[2k]|          against the previous pair, kept in a register.
+// The first pair of a block has no previous pair in the same thread, so the
+// term across each seam is left out of the loop: every thread publishes the
+// new a[] at its first and last point in its own cache line, and after the
+// loop's barrier one thread adds |last[t-1] - first[t]| for each seam.
+// The updates are the same operations as prb_a, so a[] is bit-identical;
+// the error is the same sum in a different order.
+#include <math.h>
+#include <omp.h>
+
+#define RB_MAX_THREADS 256
+
+typedef struct {
+    double first, last;         // new a[] at the first and last point of the block
+    double error;
+    int empty;
+    char pad[64 - 3 * sizeof(double) - sizeof(int)];
+} rb_slot_t;
+
+static rb_slot_t rb_slots[RB_MAX_THREADS] __attribute__((aligned(64)));
+
+// One red/black iteration over a[0..n) (n even); returns the error of prb_a
+double rb_fused_sweep(double *a, int n) {
+    int npairs = n / 2;
+    int nthreads = omp_get_max_threads() < RB_MAX_THREADS ? omp_get_max_threads() : RB_MAX_THREADS;
+    double error = 0.0;
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int nt = omp_get_num_threads(), t = omp_get_thread_num();
+        int k0 = (long) npairs * t / nt, k1 = (long) npairs * (t + 1) / nt;
+        double sum = 0.0, prev = 0.0;
+        int k;
+
+        for (k = k0; k < k1; k++) {
+            double black = a[2*k], red = a[2*k+1];
+            red = (red + black) / 2.0;
+            black = (black + red) / 2.0;
+            a[2*k] = black;
+            a[2*k+1] = red;
+            sum += fabs(black - red);
+            if (k > k0) {
+                sum += fabs(prev - black);
+            }
+            prev = red;
+        }
+
+        rb_slots[t].empty = k1 == k0;
+        if (k1 > k0) {
+            rb_slots[t].first = a[2*k0];
+            rb_slots[t].last = a[2*k1-1];
+        }
+        rb_slots[t].error = sum;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int s, left = -1;
+            for (s = 0; s < nt; s++) {
+                if (rb_slots[s].empty) {
+                    continue;
+                }
+                if (left >= 0) {
+                    error += fabs(rb_slots[left].last - rb_slots[s].first);
+                }
+                error += rb_slots[s].error;
+                left = s;
+            }
+        }
+    }
+    return error;
+}
@@ -0,0 +1,57 @@
+// Colour-separated (SoA) storage for the red/black iteration
+//
+// The interleaved a[] of prb_a is split into
+//     black[k] = a[2k]      red[k] = a[2k+1]       k = 0 .. n/2-1
+// so both colour updates are unit-stride loops over whole cache lines,
+//     red[k]   = (red[k] + black[k]) / 2
+//     black[k] = (black[k] + red[k]) / 2
+// which vectorise without gathers or shuffles.  The error of prb_a is
+//     sum |black[k] - red[k]| + sum |red[k] - black[k+1]|.
+// The arithmetic is the same as on a[], so merging back gives a bit-identical
+// array.  n must be even.
+#include <math.h>
+#include <omp.h>
+
+void rb_soa_split(const double *a, double *red, double *black, int n) {
+    int k;
+    #pragma omp parallel for schedule(static)
+        for (k = 0; k < n / 2; k++) {
+            black[k] = a[2*k];
+            red[k] = a[2*k+1];
+        }
+}
+
+void rb_soa_merge(const double *red, const double *black, double *a, int n) {
+    int k;
+    #pragma omp parallel for schedule(static)
+        for (k = 0; k < n / 2; k++) {
+            a[2*k] = black[k];
+            a[2*k+1] = red[k];
+        }
+}
+
+void rb_soa_sweep(double *restrict red, double *restrict black, int n) {
+    int k;
+    #pragma omp parallel
+    {
+        #pragma omp for simd schedule(static)
+            for (k = 0; k < n / 2; k++) {
+                red[k] = (red[k] + black[k]) / 2.0;
+            }
+
+        #pragma omp for simd schedule(static)
+            for (k = 0; k < n / 2; k++) {
+                black[k] = (black[k] + red[k]) / 2.0;
+            }
+    }
+}
+
+double rb_soa_error(const double *restrict red, const double *restrict black, int n) {
+    int k, m = n / 2;
+    double error = 0.0;
+    #pragma omp parallel for simd schedule(static) reduction(+:error)
+        for (k = 0; k < m - 1; k++) {
+            error = error + fabs(black[k] - red[k]) + fabs(red[k] - black[k+1]);
+        }
+    return error + fabs(black[m-1] - red[m-1]);
+}
@@ -0,0 +1,202 @@
+// Pipelined red/black windows: several iterations per pass over a[]
+//
+// The sweep couples a[2k] and a[2k+1] only, so a thread can take its block
+// of pairs through several iterations without waiting for anybody.  The one
+// thing that crosses a block seam is the error term |a[2k-1] - a[2k]| between
+// the last pair of one block and the first pair of the next.
+//
+// A window runs w iterations in one parallel region:
+//   - each thread owns a contiguous block of pairs and walks it in chunks
+//     of `chunk` pairs; a chunk is taken through all w iterations while it
+//     sits in L2, adding the error terms of each iteration t to sum[t]
+//     (update and error are two unit-stride loops over the cached chunk);
+//   - after its first chunk a thread publishes the new a[] at its first
+//     point for every t, then bumps its progress counter (one cache line per
+//     thread) to the window's generation number;
+//   - at the end of its block a thread waits only for its right neighbour's
+//     counter and adds the seam terms.
+// The region's closing barrier is the only global synchronisation per
+// window, against three per iteration in prb_a.
+//
+// rb_wave_converge() sizes each window from the decay rate of the errors
+// so far (rb_converge_predict() of converge.c), up to wmax.  A window reads
+// its first iteration from one buffer and writes every iteration to the
+// other, which leaves the input untouched as a checkpoint without a copy
+// pass; the buffers swap after each window.
+// If the error first drops below tol before the last iteration of a
+// window, the needed iterations are replayed from that input instead, so
+// the result is that of prb_a's loop.  The second buffer is the caller's
+// work array; the result is copied back to a[] if it ends up there.
+#include <math.h>
+#include <sched.h>
+#include <omp.h>
+
+#include "converge.h"
+#include "rb_wave.h"
+
+#define RB_WAVE_THREADS 256
+
+typedef struct {
+    long progress;              // generation of the last published seam
+    char pad[64 - sizeof(long)];
+} rb_progress_t;
+
+static rb_progress_t rb_progress[RB_WAVE_THREADS] __attribute__((aligned(64)));
+static double rb_seam[RB_WAVE_THREADS][RB_WAVE_MAX] __attribute__((aligned(64)));
+static double rb_partial[RB_WAVE_THREADS][RB_WAVE_MAX] __attribute__((aligned(64)));
+static long rb_generation;
+
+// w iterations from src[0..n) into dst; error[t] gets the error after iteration t
+static void rb_wave_window(const double *src, double *dst, int n, int w, int chunk, double *error) {
+    int npairs = n / 2;
+    int nthreads = omp_get_max_threads();
+    long gen = ++rb_generation;
+    int s, t, ran = 0;
+
+    nthreads = nthreads < RB_WAVE_THREADS ? nthreads : RB_WAVE_THREADS;
+    nthreads = nthreads < npairs ? nthreads : npairs;
+
+    #pragma omp parallel num_threads(nthreads) private(t)
+    {
+        int nt = omp_get_num_threads(), id = omp_get_thread_num();
+        int k0 = (long) npairs * id / nt, k1 = (long) npairs * (id + 1) / nt;
+        double sum[RB_WAVE_MAX], lastred[RB_WAVE_MAX];
+        int c0, c1, k;
+
+        // The team may be smaller than asked for (OMP_DYNAMIC, thread limit)
+        if (id == 0) {
+            ran = nt;
+        }
+        for (t = 0; t < w; t++) {
+            sum[t] = 0.0;
+        }
+
+        for (c0 = k0; c0 < k1; c0 = c1) {
+            c1 = c0 + chunk < k1 ? c0 + chunk : k1;
+
+            for (t = 0; t < w; t++) {
+                const double *in = t == 0 ? src : dst;
+                double *a = dst;
+                double s_t = 0.0;
+
+                // The chunk is in cache after t = 0: update, then sum its inner error terms
+                #pragma omp simd
+                    for (k = c0; k < c1; k++) {
+                        double black = in[2*k], red = in[2*k+1];
+                        red = (red + black) / 2.0;
+                        a[2*k+1] = red;
+                        a[2*k] = (black + red) / 2.0;
+                    }
+                #pragma omp simd reduction(+:s_t)
+                    for (k = 2*c0; k < 2*c1 - 1; k++) {
+                        s_t += fabs(a[k] - a[k+1]);
+                    }
+
+                // Seam to the previous chunk of this block, or publish the block's first point
+                if (c0 == k0) {
+                    rb_seam[id][t] = dst[2*c0];
+                } else {
+                    s_t += fabs(lastred[t] - dst[2*c0]);
+                }
+                lastred[t] = dst[2*c1-1];
+                sum[t] += s_t;
+            }
+
+            if (c0 == k0) {
+                __atomic_store_n(&rb_progress[id].progress, gen, __ATOMIC_RELEASE);
+            }
+        }
+
+        // Seam to the right neighbour's block
+        if (id + 1 < nt) {
+            while (__atomic_load_n(&rb_progress[id + 1].progress, __ATOMIC_ACQUIRE) < gen) {
+                sched_yield();
+            }
+            for (t = 0; t < w; t++) {
+                sum[t] += fabs(lastred[t] - rb_seam[id + 1][t]);
+            }
+        }
+
+        for (t = 0; t < w; t++) {
+            rb_partial[id][t] = sum[t];
+        }
+    }
+
+    for (t = 0; t < w; t++) {
+        error[t] = 0.0;
+        for (s = 0; s < ran; s++) {
+            error[t] += rb_partial[s][t];
+        }
+    }
+}
+
+// iters iterations with no error: each pair is carried through in registers
+static void rb_wave_replay(double *a, int n, int iters) {
+    int k, t;
+    #pragma omp parallel for private(t) schedule(static)
+        for (k = 0; k < n / 2; k++) {
+            double black = a[2*k], red = a[2*k+1];
+            for (t = 0; t < iters; t++) {
+                red = (red + black) / 2.0;
+                black = (black + red) / 2.0;
+            }
+            a[2*k] = black;
+            a[2*k+1] = red;
+        }
+}
+
+// work: a second array of n doubles, best first touched by the caller's threads
+int rb_wave_converge(double *a, double *work, int n, double tol, int wmax, int chunk, rb_wave_stats_t *st) {
+    double error[RB_WAVE_MAX], e0 = 0.0, e1 = 0.0;
+    int t0 = -1, t1 = -1, it = 0, w, t, k;
+    double *cur = a, *next = work, *swap;
+
+    wmax = wmax < 1 ? 1 : wmax > RB_WAVE_MAX ? RB_WAVE_MAX : wmax;
+    chunk = chunk < 1 ? 1 : chunk;
+    st->windows = st->rollbacks = st->replayed = st->copyback = 0;
+
+    for (;;) {
+        // Two iterations give a decay rate; after that aim at the predicted end
+        w = wmax < 2 ? wmax : 2;
+        if (t0 >= 0) {
+            int left = rb_converge_predict(e0, t0, e1, t1, tol);
+            w = left < 1 ? 1 : left < wmax ? left : wmax;
+        }
+
+        rb_wave_window(cur, next, n, w, chunk, error);
+        st->windows++;
+
+        for (t = 0; t < w && error[t] >= tol; t++) {
+        }
+        if (t < w - 1) {
+            // Went past the first converged iteration: cur still holds the window's input
+            rb_wave_replay(cur, n, t + 1);
+            st->rollbacks++;
+            st->replayed += t + 1;
+        } else {
+            swap = cur;
+            cur = next;
+            next = swap;
+        }
+        if (t < w) {
+            it += t + 1;
+            st->error = error[t];
+            break;
+        }
+
+        it += w;
+        e0 = w > 1 ? error[w-2] : e1;
+        t0 = w > 1 ? it - 1 : t1;
+        e1 = error[w-1];
+        t1 = it;
+    }
+
+    if (cur != a) {
+        #pragma omp parallel for schedule(static)
+            for (k = 0; k < n; k++) {
+                a[k] = cur[k];
+            }
+        st->copyback = 1;
+    }
+    return it;
+}
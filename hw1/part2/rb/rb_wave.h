@@ -0,0 +1,17 @@
+// rb_wave.c: pipelined multi-iteration red/black windows
+#ifndef RB_WAVE_H
+#define RB_WAVE_H
+
+#define RB_WAVE_MAX 64          // longest window (iterations per pass)
+
+typedef struct {
+    int windows;                // parallel regions run
+    int rollbacks;              // windows redone after passing convergence
+    int replayed;               // iterations redone after a rollback
+    int copyback;               // 1 if the result was copied back from the second buffer
+    double error;               // error at the returned iteration
+} rb_wave_stats_t;
+
+int rb_wave_converge(double *, double *, int, double, int, int, rb_wave_stats_t *);
+
+#endif
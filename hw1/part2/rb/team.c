@@ -0,0 +1,232 @@
+// Persistent, pinned thread team with a dissemination barrier
+//
+// The workers are created once and wait for team_run() by watching a job
+// counter, so starting a region is one store and one cache-line transfer
+// per worker instead of an OpenMP fork.
+//
+// Barrier: sense-reversing dissemination barrier (Mellor-Crummey and Scott).
+// In round r member i signals member (i + 2^r) mod P and waits for the
+// signal from (i - 2^r) mod P; after ceil(log2 P) rounds everybody has heard
+// from everybody.  Flags are double buffered by parity and the sense flips
+// every second barrier, so no flag ever has to be reset.  A member's flags
+// share one cache line that only its partners write.
+//
+// Reduction: each member writes its value into its own slot, the barrier
+// publishes the slots, and every member adds all of them in id order.  The
+// sum is therefore identical on every member and from run to run.  Slots are
+// double buffered so the next team_sum() cannot overwrite a slot still
+// being read.
+//
+// Waits spin with pause for a while and then yield; a team larger than the
+// number of online CPUs yields straight away, since the member it waits for
+// may need this CPU.
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <immintrin.h>
+
+#include "team.h"
+
+#define TEAM_MAX    256
+#define TEAM_ROUNDS 8               // ceil(log2(TEAM_MAX))
+#define TEAM_SPINS  2000            // pause spins before yielding
+
+int place_pin(int);                 // placement prototype (affinity.c)
+
+typedef struct {
+    int flags[2][TEAM_ROUNDS];      // written by the partners of each round
+    int parity __attribute__((aligned(64)));
+    int sense;
+    long epoch;                     // team_sum() calls so far
+    double value[2];
+} __attribute__((aligned(64))) team_member_t;
+
+struct team {
+    int nthreads, rounds, pin, spins;
+    team_member_t *members;
+    pthread_t *threads;
+    long job __attribute__((aligned(64)));
+    team_fn fn;
+    void *arg;
+    int quit;
+};
+
+typedef struct {
+    team_t *team;
+    int id;
+} team_start_t;
+
+static void team_wait(const team_t *team, int *flag, int value) {
+    int spins = 0;
+    while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) != value) {
+        if (++spins < team->spins) {
+            _mm_pause();
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void team_pin(team_t *team, int id) {
+    if (team->pin && place_pin(id) != 0) {
+        fprintf(stderr, "team: member %d could not be pinned, it runs unbound\n", id);
+    }
+}
+
+static void *team_worker(void *p) {
+    team_start_t start = *(team_start_t *) p;
+    team_t *team = start.team;
+    long last = 0;
+
+    free(p);
+    team_pin(team, start.id);
+
+    for (;;) {
+        int spins = 0;
+        while (__atomic_load_n(&team->job, __ATOMIC_ACQUIRE) == last) {
+            if (++spins < team->spins) {
+                _mm_pause();
+            } else {
+                sched_yield();
+            }
+        }
+        last++;
+        if (team->quit) {
+            return NULL;
+        }
+        team->fn(team, start.id, team->arg);
+        team_barrier(team, start.id);
+    }
+}
+
+team_t *team_create(int nthreads, int pin) {
+    team_t *team = (team_t *) calloc(1, sizeof(team_t));
+    int k;
+
+    if (team == NULL) {
+        return NULL;
+    }
+    nthreads = nthreads < 1 ? 1 : nthreads > TEAM_MAX ? TEAM_MAX : nthreads;
+    team->nthreads = nthreads;
+    team->pin = pin;
+    team->spins = nthreads > sysconf(_SC_NPROCESSORS_ONLN) ? 0 : TEAM_SPINS;
+    for (team->rounds = 0; (1 << team->rounds) < nthreads; team->rounds++) {
+    }
+
+    team->members = (team_member_t *) aligned_alloc(64, nthreads * sizeof(team_member_t));
+    team->threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    if (team->members == NULL || team->threads == NULL) {
+        free(team->threads);
+        free(team->members);
+        free(team);
+        return NULL;
+    }
+    memset(team->members, 0, nthreads * sizeof(team_member_t));
+    for (k = 0; k < nthreads; k++) {
+        team->members[k].sense = 1;
+    }
+
+    team_pin(team, 0);
+    for (k = 1; k < nthreads; k++) {
+        team_start_t *start = (team_start_t *) malloc(sizeof(team_start_t));
+        if (start == NULL) {
+            break;
+        }
+        start->team = team;
+        start->id = k;
+        if (pthread_create(&team->threads[k], NULL, team_worker, start) != 0) {
+            free(start);
+            break;
+        }
+    }
+    if (k < nthreads) {
+        // Stop the workers already started
+        team->nthreads = k;
+        team_destroy(team);
+        return NULL;
+    }
+    return team;
+}
+
+void team_destroy(team_t *team) {
+    int k;
+
+    team->quit = 1;
+    __atomic_store_n(&team->job, team->job + 1, __ATOMIC_RELEASE);
+    for (k = 1; k < team->nthreads; k++) {
+        pthread_join(team->threads[k], NULL);
+    }
+    free(team->threads);
+    free(team->members);
+    free(team);
+}
+
+int team_size(const team_t *team) {
+    return team->nthreads;
+}
+
+void team_run(team_t *team, team_fn fn, void *arg) {
+    team->fn = fn;
+    team->arg = arg;
+    __atomic_store_n(&team->job, team->job + 1, __ATOMIC_RELEASE);
+    fn(team, 0, arg);
+    team_barrier(team, 0);
+}
+
+void team_barrier(team_t *team, int id) {
+    team_member_t *me = &team->members[id];
+    int parity = me->parity, sense = me->sense;
+    int r, d;
+
+    for (r = 0, d = 1; r < team->rounds; r++, d <<= 1) {
+        team_member_t *partner = &team->members[(id + d) % team->nthreads];
+        __atomic_store_n(&partner->flags[parity][r], sense, __ATOMIC_RELEASE);
+        team_wait(team, &me->flags[parity][r], sense);
+    }
+    if (parity == 1) {
+        me->sense = !sense;
+    }
+    me->parity = 1 - parity;
+}
+
+double team_sum(team_t *team, int id, double value) {
+    int slot = team->members[id].epoch++ & 1;
+    double sum = 0.0;
+    int k;
+
+    team->members[id].value[slot] = value;
+    team_barrier(team, id);
+    for (k = 0; k < team->nthreads; k++) {
+        sum += team->members[k].value[slot];
+    }
+    return sum;
+}
+
+void team_range(const team_t *team, int id, long n, long *lo, long *hi) {
+    *lo = n * id / team->nthreads;
+    *hi = n * (id + 1) / team->nthreads;
+}
+
+typedef struct {
+    team_body body;
+    long n;
+    void *arg;
+} team_for_t;
+
+static void team_for_member(team_t *team, int id, void *p) {
+    team_for_t *loop = (team_for_t *) p;
+    long lo, hi;
+
+    team_range(team, id, loop->n, &lo, &hi);
+    if (lo < hi) {
+        loop->body(lo, hi, loop->arg);
+    }
+}
+
+void team_parallel_for(team_t *team, long n, team_body body, void *arg) {
+    team_for_t loop = { body, n, arg };
+    team_run(team, team_for_member, &loop);
+}
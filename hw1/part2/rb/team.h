@@ -0,0 +1,33 @@
+// Header File for the persistent thread team (team.c)
+//
+// A team is the calling thread (id 0) plus nthreads-1 pinned worker
+// threads that live until team_destroy().  team_run() starts a function on
+// every member and returns when all of them are done; inside it the members
+// synchronise with
+//   team_barrier()      sense-reversing dissemination barrier
+//   team_sum()          barrier fused with a sum over all members; every
+//                       member gets the same result, added in id order
+//   team_range()        the member's static share of [0, n)
+// and team_parallel_for() is the one-call form for a single loop.
+#ifndef TEAM_H
+#define TEAM_H
+
+typedef struct team team_t;
+
+typedef void (*team_fn)(team_t *, int id, void *arg);
+typedef void (*team_body)(long lo, long hi, void *arg);
+
+// pin != 0: member i is bound where the placement policy puts thread i
+// (place_pin() of affinity.c, RB_PLACE).  NULL if memory or threads run out.
+team_t *team_create(int nthreads, int pin);
+void team_destroy(team_t *);
+int team_size(const team_t *);
+
+void team_run(team_t *, team_fn, void *arg);
+void team_barrier(team_t *, int id);
+double team_sum(team_t *, int id, double value);
+void team_range(const team_t *, int id, long n, long *lo, long *hi);
+
+void team_parallel_for(team_t *, long n, team_body, void *arg);
+
+#endif